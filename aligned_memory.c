@@ -0,0 +1,28 @@
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200112L // posix_memalign under -std=c11
+#include <stdlib.h>
+#include "aligned_memory.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+void* alloc_cache_aligned(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, CACHE_LINE_SIZE);
+#else
+    void* memory = NULL;
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, size) != 0) {
+        return NULL;
+    }
+    return memory;
+#endif
+}
+
+void free_cache_aligned(void* memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
@@ -0,0 +1,20 @@
+#ifndef ALIGNED_MEMORY_H
+#define ALIGNED_MEMORY_H
+
+#include <stddef.h>
+
+#define CACHE_LINE_SIZE 64
+
+// Hints that the cache line holding address is read soon; never faults, whatever the address
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define PREFETCH(address) __builtin_prefetch(address)
+#endif
+
+// Allocation starting on a cache-line boundary; release with free_cache_aligned
+void* alloc_cache_aligned(size_t size);
+void free_cache_aligned(void* memory);
+
+#endif
@@ -0,0 +1,75 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "benchmark.h"
+#include "branch_buffer.h"
+#include "predictor.h"
+#include "process_stats.h"
+#include "synthetic_trace.h"
+
+// Best wall time of BENCHMARK_REPEATS fresh runs of predictor slot over the records
+static int time_predictor(const Config* config, const PredictorConfig* sizing, int slot, const BranchBuffer* records,
+    double* best_seconds, double* misprediction_rate) {
+    *best_seconds = -1;
+    for (int repeat = 0; repeat < BENCHMARK_REPEATS; repeat++) {
+        Predictor predictors[MAX_PREDICTORS];
+        int count = create_predictors(predictors, config->which_predictor, sizing);
+        if (count <= slot) {
+            destroy_predictors(predictors, count);
+            return 1;
+        }
+
+        double start = monotonic_seconds();
+        SimulateRecords(records->records, records->count, &predictors[slot], 1);
+        double seconds = monotonic_seconds() - start;
+
+        if (*best_seconds < 0 || seconds < *best_seconds) *best_seconds = seconds;
+        *misprediction_rate = records->count ? (double)predictors[slot].mispredictions / records->count * 100 : 0.0;
+        destroy_predictors(predictors, count);
+    }
+    return 0;
+}
+
+int RunBenchmark(const Config* config) {
+    PredictorConfig sizing;
+    config_predictor_sizing(config, config->ghr_bits.values[0], config->bhr_bits.values[0], config->entries.values[0], &sizing);
+
+    // Created once up front to validate the configuration and learn the predictor names
+    Predictor predictors[MAX_PREDICTORS];
+    int count = create_predictors(predictors, config->which_predictor, &sizing);
+    if (count == 0) {
+        return 1;
+    }
+
+    printf("Benchmark: %llu branches per pattern, seed %llu, best of %d runs\n",
+        (unsigned long long)config->benchmark, (unsigned long long)config->benchmark_seed, BENCHMARK_REPEATS);
+    printf("%-18s%-20s%16s%12s%16s\n", "Pattern", "Predictor", "Branches/s", "ns/branch", "Mispredict %");
+
+    int result = 0;
+    BranchBuffer records;
+    branch_buffer_init(&records);
+    for (int pattern = 0; pattern < SYNTHETIC_PATTERN_COUNT && result == 0; pattern++) {
+        if (synthetic_generate((SyntheticPattern)pattern, (size_t)config->benchmark, config->benchmark_seed, &records)) {
+            result = 1;
+            break;
+        }
+
+        for (int slot = 0; slot < count; slot++) {
+            double seconds, rate;
+            if (time_predictor(config, &sizing, slot, &records, &seconds, &rate)) {
+                result = 1;
+                break;
+            }
+            double per_second = seconds > 0 ? records.count / seconds : 0.0;
+            double nanoseconds = records.count ? seconds * 1e9 / records.count : 0.0;
+            printf("%-18s%-20s%16.0f%12.2f%16.4f\n", synthetic_pattern_name((SyntheticPattern)pattern),
+                predictors[slot].name, per_second, nanoseconds, rate);
+        }
+    }
+    branch_buffer_free(&records);
+    destroy_predictors(predictors, count);
+
+    printf("Peak RSS: %.1f MiB\n", peak_rss_bytes() / (1024.0 * 1024.0));
+    return result;
+}
@@ -0,0 +1,14 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "config.h"
+
+// Times every selected predictor on each synthetic pattern (see synthetic_trace.h) of
+// config->benchmark branches and prints branches/second, ns/branch and the peak resident set.
+// Runs are single-threaded and the best of BENCHMARK_REPEATS is reported, so the figures are
+// comparable between builds on the same machine.
+int RunBenchmark(const Config* config);
+
+#define BENCHMARK_REPEATS 3
+
+#endif
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch_buffer.h"
+
+#define INITIAL_CAPACITY (1 << 16)
+
+void branch_buffer_init(BranchBuffer* buffer) {
+    buffer->records = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+void branch_buffer_free(BranchBuffer* buffer) {
+    free(buffer->records);
+    branch_buffer_init(buffer);
+}
+
+int branch_buffer_append(BranchBuffer* buffer, const BranchRecord* record) {
+    if (buffer->count == buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : INITIAL_CAPACITY;
+        BranchRecord* records = (BranchRecord*)realloc(buffer->records, capacity * sizeof(BranchRecord));
+        if (!records) {
+            perror("Failed to allocate memory for branch records");
+            return 1;
+        }
+        buffer->records = records;
+        buffer->capacity = capacity;
+    }
+    buffer->records[buffer->count++] = *record;
+    return 0;
+}
+
+int branch_buffer_append_buffer(BranchBuffer* buffer, const BranchBuffer* other) {
+    size_t count = buffer->count + other->count;
+    if (count > buffer->capacity) {
+        BranchRecord* records = (BranchRecord*)realloc(buffer->records, count * sizeof(BranchRecord));
+        if (!records) {
+            perror("Failed to allocate memory for branch records");
+            return 1;
+        }
+        buffer->records = records;
+        buffer->capacity = count;
+    }
+    if (other->count > 0) {
+        memcpy(buffer->records + buffer->count, other->records, other->count * sizeof(BranchRecord));
+    }
+    buffer->count = count;
+    return 0;
+}
+
+static int buffer_sink_write(void* context, const BranchRecord* record) {
+    return branch_buffer_append((BranchBuffer*)context, record);
+}
+
+BranchSink branch_buffer_sink(BranchBuffer* buffer) {
+    BranchSink sink;
+    sink.context = buffer;
+    sink.write = buffer_sink_write;
+    return sink;
+}
+
+static int conditional_sink_write(void* context, const BranchRecord* record) {
+    return record->kind == BRANCH_CONDITIONAL ? branch_buffer_append((BranchBuffer*)context, record) : 0;
+}
+
+BranchSink branch_buffer_conditional_sink(BranchBuffer* buffer) {
+    BranchSink sink;
+    sink.context = buffer;
+    sink.write = conditional_sink_write;
+    return sink;
+}
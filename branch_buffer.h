@@ -0,0 +1,27 @@
+#ifndef BRANCH_BUFFER_H
+#define BRANCH_BUFFER_H
+
+#include <stddef.h>
+#include "branch_trace.h"
+
+// Growable in-memory array of decoded branch records, for runs that replay one trace many times
+typedef struct {
+    BranchRecord* records;
+    size_t count;
+    size_t capacity;
+} BranchBuffer;
+
+void branch_buffer_init(BranchBuffer* buffer);
+void branch_buffer_free(BranchBuffer* buffer);
+int branch_buffer_append(BranchBuffer* buffer, const BranchRecord* record);
+
+// Appends every record of other, growing the buffer at most once
+int branch_buffer_append_buffer(BranchBuffer* buffer, const BranchBuffer* other);
+
+// Sink that appends to the buffer, so the filter can decode a trace straight into memory
+BranchSink branch_buffer_sink(BranchBuffer* buffer);
+
+// Same, keeping only the conditional branches, for runs that simulate branch directions only
+BranchSink branch_buffer_conditional_sink(BranchBuffer* buffer);
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "branch_classifier.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// A trace line looks like
+//   Info 'riscvOVPsim/cpu', 0x0000000080000104(main+4): Machine 00b50463 beq     a0,a1,8000010c
+// The mnemonic is the token after the instruction encoding, which follows the ':' that ends the
+// address field. C++ symbols such as (ns::fn+4) hold colons too, so that is the first ':' followed
+// by a blank.
+
+#define MAX_MNEMONIC_LENGTH 8
+
+// Perfect hash over the branch mnemonics: slot = (packed mnemonic * MNEMONIC_HASH_MULTIPLIER) >> 59.
+// The multiplier was searched offline so every mnemonic below gets its own slot; re-run the
+// search if the set changes.
+#define MNEMONIC_HASH_MULTIPLIER 0x4e17ea049b79003bULL
+#define MNEMONIC_HASH_BITS 5
+
+// How the operands refine the kind of a jump mnemonic
+typedef enum {
+    OPERANDS_IGNORED = 0,
+    OPERANDS_JAL,           // jal [rd,]target: a call when rd is a link register or omitted
+    OPERANDS_JALR,          // jalr [rd,]rs1 or jalr rd,offset(rs1)
+    OPERANDS_JR             // jr rs1 / c.jr rs1: a return through a link register
+} OperandRule;
+
+typedef struct {
+    const char* mnemonic;
+    BranchKind kind;
+    OperandRule rule;
+} MnemonicSlot;
+
+static const MnemonicSlot mnemonic_table[1 << MNEMONIC_HASH_BITS] = {
+    [20] = { "beq", BRANCH_CONDITIONAL },
+    [15] = { "bne", BRANCH_CONDITIONAL },
+    [0]  = { "blt", BRANCH_CONDITIONAL },
+    [27] = { "bge", BRANCH_CONDITIONAL },
+    [4]  = { "bltu", BRANCH_CONDITIONAL },
+    [30] = { "bgeu", BRANCH_CONDITIONAL },
+    [26] = { "beqz", BRANCH_CONDITIONAL },
+    [22] = { "bnez", BRANCH_CONDITIONAL },
+    [16] = { "blez", BRANCH_CONDITIONAL },
+    [1]  = { "bgez", BRANCH_CONDITIONAL },
+    [7]  = { "bltz", BRANCH_CONDITIONAL },
+    [24] = { "bgtz", BRANCH_CONDITIONAL },
+    [17] = { "bgt", BRANCH_CONDITIONAL },
+    [9]  = { "ble", BRANCH_CONDITIONAL },
+    [21] = { "bgtu", BRANCH_CONDITIONAL },
+    [13] = { "bleu", BRANCH_CONDITIONAL },
+    [6]  = { "c.beqz", BRANCH_CONDITIONAL },
+    [2]  = { "c.bnez", BRANCH_CONDITIONAL },
+    [5]  = { "jalr", BRANCH_INDIRECT, OPERANDS_JALR },
+    [31] = { "jr", BRANCH_INDIRECT, OPERANDS_JR },
+    [14] = { "c.jr", BRANCH_INDIRECT, OPERANDS_JR },
+    [19] = { "c.jalr", BRANCH_INDIRECT_CALL },
+    [8]  = { "ret", BRANCH_RETURN },
+    [3]  = { "jal", BRANCH_CALL, OPERANDS_JAL },
+    [10] = { "j", BRANCH_JUMP },
+    [12] = { "c.j", BRANCH_JUMP },
+    [23] = { "c.jal", BRANCH_CALL },
+    [29] = { "call", BRANCH_CALL },
+    [11] = { "tail", BRANCH_JUMP },
+};
+
+static unsigned lowest_set_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+// Finds the first ':' with 32/16-byte compares, falling back to memchr for the tail
+static const char* find_colon(const char* p, const char* end) {
+#ifdef HAVE_AVX2
+    const __m256i colon32 = _mm256_set1_epi8(':');
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)p);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, colon32));
+        if (mask) return p + lowest_set_bit(mask);
+        p += 32;
+    }
+#endif
+#ifdef HAVE_SSE2
+    const __m128i colon16 = _mm_set1_epi8(':');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, colon16));
+        if (mask) return p + lowest_set_bit(mask);
+        p += 16;
+    }
+#endif
+    return (const char*)memchr(p, ':', end - p);
+}
+
+static const char* find_address_end(const char* p, const char* end) {
+    for (const char* colon = find_colon(p, end); colon; colon = find_colon(colon + 1, end)) {
+        if (colon + 1 == end || colon[1] == ' ' || colon[1] == '\t') return colon;
+    }
+    return NULL;
+}
+
+static const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static const char* token_end(const char* p, const char* end) {
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    return p;
+}
+
+static bool is_hex_token(const char* p, const char* end) {
+    for (; p < end; p++) {
+        char c = (char)(*p | 0x20);
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+static const MnemonicSlot* lookup_mnemonic(const char* mnemonic, size_t length) {
+    if (length == 0 || length > MAX_MNEMONIC_LENGTH) {
+        return NULL;
+    }
+
+    uint64_t key = 0;
+    for (size_t i = 0; i < length; i++) {
+        key |= (uint64_t)(unsigned char)mnemonic[i] << (8 * i);
+    }
+
+    const MnemonicSlot* slot = &mnemonic_table[(key * MNEMONIC_HASH_MULTIPLIER) >> (64 - MNEMONIC_HASH_BITS)];
+    if (slot->mnemonic && strlen(slot->mnemonic) == length && memcmp(slot->mnemonic, mnemonic, length) == 0) {
+        return slot;
+    }
+    return NULL;
+}
+
+// ra (x1) and t0 (x5) are the link registers
+static bool is_link_register(const char* name, const char* end) {
+    size_t length = end - name;
+    return length == 2 && (memcmp(name, "ra", 2) == 0 || memcmp(name, "x1", 2) == 0
+        || memcmp(name, "t0", 2) == 0 || memcmp(name, "x5", 2) == 0);
+}
+
+// Splits "rd,rs1", "rd,offset(rs1)" or "rd,rs1,offset" at the commas; returns the operand count
+static int split_operands(const char* p, const char* end, const char* starts[3], const char* ends[3]) {
+    int count = 0;
+    while (p < end && count < 3) {
+        const char* comma = (const char*)memchr(p, ',', end - p);
+        const char* stop = comma ? comma : end;
+        starts[count] = p;
+        ends[count] = stop;
+        count++;
+        p = comma ? comma + 1 : end;
+    }
+    return count;
+}
+
+// The register of a "offset(register)" operand, or the operand itself
+static void base_register(const char** start, const char** end) {
+    const char* open = (const char*)memchr(*start, '(', *end - *start);
+    if (open && (*end)[-1] == ')') {
+        *start = open + 1;
+        (*end)--;
+    }
+}
+
+static BranchKind refine_jump(OperandRule rule, BranchKind kind, const char* operands, const char* end) {
+    const char* starts[3];
+    const char* ends[3];
+    int count = split_operands(operands, end, starts, ends);
+    if (count == 0) {
+        return kind;
+    }
+
+    switch (rule) {
+        case OPERANDS_JAL:
+            // A lone target means rd = ra
+            return count == 1 || is_link_register(starts[0], ends[0]) ? BRANCH_CALL : BRANCH_JUMP;
+        case OPERANDS_JALR: {
+            bool links = count == 1 || is_link_register(starts[0], ends[0]);
+            const char* rs1 = starts[count == 1 ? 0 : 1];
+            const char* rs1_end = ends[count == 1 ? 0 : 1];
+            base_register(&rs1, &rs1_end);
+            if (links) return BRANCH_INDIRECT_CALL;
+            return is_link_register(rs1, rs1_end) ? BRANCH_RETURN : BRANCH_INDIRECT;
+        }
+        case OPERANDS_JR:
+            return is_link_register(starts[0], ends[0]) ? BRANCH_RETURN : BRANCH_INDIRECT;
+        default:
+            return kind;
+    }
+}
+
+BranchKind classify_trace_line(const char* line, size_t length, int* instruction_bytes) {
+    const char* end = line + length;
+    const char* colon = find_address_end(line, end);
+    *instruction_bytes = 4;
+    if (!colon) {
+        return BRANCH_NONE;
+    }
+
+    // Optional privilege mode ("Machine", "User", ...), then the encoding, then the mnemonic
+    const char* token = skip_spaces(colon + 1, end);
+    const char* stop = token_end(token, end);
+    if (!is_hex_token(token, stop)) {
+        token = skip_spaces(stop, end);
+        stop = token_end(token, end);
+    }
+    if (stop - token == 4) {
+        *instruction_bytes = 2; // Four hex digits encode a compressed instruction
+    }
+    token = skip_spaces(stop, end);
+    stop = token_end(token, end);
+
+    const MnemonicSlot* slot = lookup_mnemonic(token, stop - token);
+    if (!slot) {
+        return BRANCH_NONE;
+    }
+    if (slot->rule == OPERANDS_IGNORED) {
+        return slot->kind;
+    }
+    const char* operands = skip_spaces(stop, end);
+    return refine_jump(slot->rule, slot->kind, operands, token_end(operands, end));
+}
@@ -0,0 +1,24 @@
+#ifndef BRANCH_CLASSIFIER_H
+#define BRANCH_CLASSIFIER_H
+
+#include <stddef.h>
+
+// Every kind but BRANCH_CONDITIONAL always transfers control. Calls and returns are told apart by
+// the link register (ra or t0) following the RISC-V return-address stack hints.
+typedef enum {
+    BRANCH_NONE = 0,        // Not a control-transfer instruction we track
+    BRANCH_CONDITIONAL,     // beq, bne, blt, bge, ... and their compressed/pseudo forms
+    BRANCH_INDIRECT,        // jr, jalr through a register, neither a call nor a return
+    BRANCH_JUMP,            // j, c.j, tail and jal without a link register
+    BRANCH_CALL,            // jal, c.jal and call writing the link register
+    BRANCH_INDIRECT_CALL,   // jalr and c.jalr writing the link register
+    BRANCH_RETURN,          // ret, and jr/c.jr/jalr through the link register without writing one
+    BRANCH_KIND_COUNT
+} BranchKind;
+
+// Classifies a riscvOVPsim trace line by its mnemonic field and, for jumps, its operands.
+// instruction_bytes receives the size of the encoding, 2 for compressed instructions.
+// The line does not have to be NUL-terminated.
+BranchKind classify_trace_line(const char* line, size_t length, int* instruction_bytes);
+
+#endif
@@ -0,0 +1,160 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "branch_profile.h"
+
+#define INITIAL_PROFILE_CAPACITY 1024
+
+// Fibonacci hashing of the instruction index spreads nearby branches over the table
+static size_t slot_of(const BranchProfile* profile, uint64_t address) {
+    return (size_t)(((address >> 1) * 0x9E3779B97F4A7C15ULL) >> 32) & profile->capacity_mask;
+}
+
+static BranchProfileEntry* allocate_entries(size_t capacity) {
+    BranchProfileEntry* entries = (BranchProfileEntry*)calloc(capacity, sizeof(BranchProfileEntry));
+    if (!entries) {
+        perror("Failed to allocate memory for branch profile");
+        return NULL;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        entries[i].address = BRANCH_PROFILE_EMPTY;
+    }
+    return entries;
+}
+
+BranchProfile* branch_profile_create(void) {
+    BranchProfile* profile = (BranchProfile*)malloc(sizeof(BranchProfile));
+    if (!profile) {
+        perror("Failed to allocate memory for branch profile");
+        return NULL;
+    }
+    profile->entries = allocate_entries(INITIAL_PROFILE_CAPACITY);
+    if (!profile->entries) {
+        free(profile);
+        return NULL;
+    }
+    profile->capacity_mask = INITIAL_PROFILE_CAPACITY - 1;
+    profile->count = 0;
+    return profile;
+}
+
+void branch_profile_destroy(BranchProfile* profile) {
+    if (profile) {
+        free(profile->entries);
+        free(profile);
+    }
+}
+
+static BranchProfileEntry* find_slot(const BranchProfile* profile, uint64_t address) {
+    size_t slot = slot_of(profile, address);
+    while (profile->entries[slot].address != address && profile->entries[slot].address != BRANCH_PROFILE_EMPTY) {
+        slot = (slot + 1) & profile->capacity_mask;
+    }
+    return &profile->entries[slot];
+}
+
+static int grow(BranchProfile* profile) {
+    size_t old_capacity = profile->capacity_mask + 1;
+    BranchProfileEntry* old_entries = profile->entries;
+    BranchProfileEntry* entries = allocate_entries(old_capacity * 2);
+    if (!entries) {
+        return 1;
+    }
+
+    profile->entries = entries;
+    profile->capacity_mask = old_capacity * 2 - 1;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].address != BRANCH_PROFILE_EMPTY) {
+            *find_slot(profile, old_entries[i].address) = old_entries[i];
+        }
+    }
+    free(old_entries);
+    return 0;
+}
+
+int branch_profile_record(BranchProfile* profile, uint64_t address, bool taken, bool mispredicted, bool btb_miss) {
+    BranchProfileEntry* entry = find_slot(profile, address);
+    if (entry->address == BRANCH_PROFILE_EMPTY) {
+        // Keep the load factor at most 1/2 so probe sequences stay short
+        if (2 * (profile->count + 1) > profile->capacity_mask + 1) {
+            if (grow(profile)) {
+                return 1;
+            }
+            entry = find_slot(profile, address);
+        }
+        entry->address = address;
+        profile->count++;
+    }
+    entry->executions++;
+    entry->taken += taken;
+    entry->mispredictions += mispredicted;
+    entry->btb_misses += btb_miss;
+    return 0;
+}
+
+static int compare_worst_first(const void* a, const void* b) {
+    const BranchProfileEntry* x = (const BranchProfileEntry*)a;
+    const BranchProfileEntry* y = (const BranchProfileEntry*)b;
+    if (x->mispredictions != y->mispredictions) return x->mispredictions > y->mispredictions ? -1 : 1;
+    if (x->address != y->address) return x->address < y->address ? -1 : 1;
+    return 0;
+}
+
+// Copies the used entries, sorted worst first; the caller frees the array
+static BranchProfileEntry* sorted_entries(const BranchProfile* profile) {
+    BranchProfileEntry* sorted = (BranchProfileEntry*)malloc((profile->count ? profile->count : 1) * sizeof(BranchProfileEntry));
+    if (!sorted) {
+        perror("Failed to allocate memory for branch profile report");
+        return NULL;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i <= profile->capacity_mask; i++) {
+        if (profile->entries[i].address != BRANCH_PROFILE_EMPTY) {
+            sorted[n++] = profile->entries[i];
+        }
+    }
+    qsort(sorted, n, sizeof(BranchProfileEntry), compare_worst_first);
+    return sorted;
+}
+
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? (double)part / whole * 100 : 0.0;
+}
+
+void branch_profile_print_top(const BranchProfile* profile, const char* predictor, const char* trace, int top) {
+    BranchProfileEntry* sorted = sorted_entries(profile);
+    if (!sorted) {
+        return;
+    }
+
+    size_t shown = (size_t)top < profile->count ? (size_t)top : profile->count;
+    printf("\nWorst %zu of %zu branches for %s on %s:\n", shown, profile->count, predictor, trace);
+    printf("%18s%14s%10s%16s%14s%12s\n", "Address", "Executions", "Taken %", "Mispredictions", "Mispredict %", "BTB misses");
+    for (size_t i = 0; i < shown; i++) {
+        const BranchProfileEntry* entry = &sorted[i];
+        printf("%#18llx%14llu%10.2f%16llu%14.2f%12llu\n", (unsigned long long)entry->address,
+            (unsigned long long)entry->executions, percent(entry->taken, entry->executions),
+            (unsigned long long)entry->mispredictions, percent(entry->mispredictions, entry->executions),
+            (unsigned long long)entry->btb_misses);
+    }
+    free(sorted);
+}
+
+int branch_profile_write_csv(const BranchProfile* profile, const char* predictor, FILE* out) {
+    BranchProfileEntry* sorted = sorted_entries(profile);
+    if (!sorted) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < profile->count; i++) {
+        const BranchProfileEntry* entry = &sorted[i];
+        fprintf(out, "%s,%#llx,%llu,%.4f,%llu,%.4f,%llu\n", predictor, (unsigned long long)entry->address,
+            (unsigned long long)entry->executions, percent(entry->taken, entry->executions),
+            (unsigned long long)entry->mispredictions, percent(entry->mispredictions, entry->executions),
+            (unsigned long long)entry->btb_misses);
+    }
+    free(sorted);
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef BRANCH_PROFILE_H
+#define BRANCH_PROFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per-static-branch statistics of one predictor over one trace, in an open-addressing hash table
+// keyed by the branch address (linear probing, power-of-two capacity kept at most half full).
+// Profiling is off unless a Predictor has a profile attached, so unprofiled runs pay nothing.
+
+#define BRANCH_PROFILE_EMPTY UINT64_MAX    // Never a branch address, branches are 2-byte aligned
+
+typedef struct {
+    uint64_t address;
+    uint64_t executions;
+    uint64_t taken;
+    uint64_t mispredictions;
+    uint64_t btb_misses;
+} BranchProfileEntry;
+
+typedef struct {
+    BranchProfileEntry* entries;
+    size_t capacity_mask;   // capacity - 1
+    size_t count;           // Distinct branches seen
+} BranchProfile;
+
+BranchProfile* branch_profile_create(void);
+void branch_profile_destroy(BranchProfile* profile);
+
+// Adds one execution of the branch at address; returns 1 if the table could not grow
+int branch_profile_record(BranchProfile* profile, uint64_t address, bool taken, bool mispredicted, bool btb_miss);
+
+// Prints the top branches by mispredictions (ties by address) for one predictor
+void branch_profile_print_top(const BranchProfile* profile, const char* predictor, const char* trace, int top);
+
+// Writes every branch as "predictor,address,executions,taken_rate,mispredictions,misprediction_rate,
+// btb_misses" rows, worst first; the caller writes the header (see BRANCH_PROFILE_CSV_HEADER)
+int branch_profile_write_csv(const BranchProfile* profile, const char* predictor, FILE* out);
+
+#define BRANCH_PROFILE_CSV_HEADER "predictor,address,executions,taken_rate,mispredictions,misprediction_rate,btb_misses\n"
+
+#endif
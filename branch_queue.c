@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch_queue.h"
+#include "threads.h"
+
+struct BranchQueue {
+    Mutex mutex;
+    CondVar not_full;
+    CondVar not_empty;
+
+    BranchRecord* slots;                    // BRANCH_QUEUE_BATCHES batches of BRANCH_QUEUE_BATCH_SIZE records
+    size_t counts[BRANCH_QUEUE_BATCHES];    // Records in each published batch
+    size_t head;                            // Oldest published batch
+    size_t tail;                            // Next batch to publish
+    size_t filled;                          // Published batches not yet consumed
+    size_t head_offset;                     // Records of the head batch already consumed
+    bool closed;                            // Set by the producer's close or the consumer's cancel
+    bool failed;
+
+    // Producer-private staging batch, published once full
+    BranchRecord staging[BRANCH_QUEUE_BATCH_SIZE];
+    size_t staged;
+};
+
+BranchQueue* branch_queue_create(void) {
+    BranchQueue* queue = (BranchQueue*)malloc(sizeof(BranchQueue));
+    if (!queue) {
+        perror("Failed to allocate memory for branch queue");
+        return NULL;
+    }
+    queue->slots = (BranchRecord*)malloc(BRANCH_QUEUE_BATCHES * BRANCH_QUEUE_BATCH_SIZE * sizeof(BranchRecord));
+    if (!queue->slots) {
+        perror("Failed to allocate memory for branch queue");
+        free(queue);
+        return NULL;
+    }
+
+    mutex_init(&queue->mutex);
+    cond_init(&queue->not_full);
+    cond_init(&queue->not_empty);
+    queue->head = 0;
+    queue->tail = 0;
+    queue->filled = 0;
+    queue->head_offset = 0;
+    queue->closed = false;
+    queue->failed = false;
+    queue->staged = 0;
+    return queue;
+}
+
+void branch_queue_destroy(BranchQueue* queue) {
+    cond_destroy(&queue->not_full);
+    cond_destroy(&queue->not_empty);
+    mutex_destroy(&queue->mutex);
+    free(queue->slots);
+    free(queue);
+}
+
+// Returns 1 when the consumer cancelled the queue; the staged records are then dropped
+static int publish_staged(BranchQueue* queue) {
+    mutex_lock(&queue->mutex);
+    while (queue->filled == BRANCH_QUEUE_BATCHES && !queue->closed) {
+        cond_wait(&queue->not_full, &queue->mutex);
+    }
+    bool cancelled = queue->closed;
+    mutex_unlock(&queue->mutex);
+    if (cancelled) {
+        queue->staged = 0;
+        return 1;
+    }
+
+    // The tail slot is not visible to the consumer until filled is bumped
+    memcpy(queue->slots + queue->tail * BRANCH_QUEUE_BATCH_SIZE, queue->staging, queue->staged * sizeof(BranchRecord));
+
+    mutex_lock(&queue->mutex);
+    queue->counts[queue->tail] = queue->staged;
+    queue->tail = (queue->tail + 1) % BRANCH_QUEUE_BATCHES;
+    queue->filled++;
+    cond_signal(&queue->not_empty);
+    mutex_unlock(&queue->mutex);
+
+    queue->staged = 0;
+    return 0;
+}
+
+int branch_queue_push(BranchQueue* queue, const BranchRecord* record) {
+    queue->staging[queue->staged++] = *record;
+    if (queue->staged == BRANCH_QUEUE_BATCH_SIZE) {
+        return publish_staged(queue);
+    }
+    return 0;
+}
+
+void branch_queue_close(BranchQueue* queue, bool failed) {
+    if (queue->staged > 0 && publish_staged(queue)) {
+        failed = true;
+    }
+
+    mutex_lock(&queue->mutex);
+    queue->closed = true;
+    queue->failed = failed;
+    cond_broadcast(&queue->not_empty);
+    mutex_unlock(&queue->mutex);
+}
+
+size_t branch_queue_pop(BranchQueue* queue, BranchRecord* records, size_t max_records) {
+    mutex_lock(&queue->mutex);
+    while (queue->filled == 0 && !queue->closed) {
+        cond_wait(&queue->not_empty, &queue->mutex);
+    }
+    if (queue->filled == 0) {
+        mutex_unlock(&queue->mutex);
+        return 0;
+    }
+    size_t head = queue->head;
+    size_t offset = queue->head_offset;
+    size_t available = queue->counts[head] - offset;
+    mutex_unlock(&queue->mutex);
+
+    // The head slot is not reused by the producer until filled drops
+    size_t count = available < max_records ? available : max_records;
+    memcpy(records, queue->slots + head * BRANCH_QUEUE_BATCH_SIZE + offset, count * sizeof(BranchRecord));
+
+    mutex_lock(&queue->mutex);
+    queue->head_offset += count;
+    if (queue->head_offset == queue->counts[head]) {
+        queue->head = (head + 1) % BRANCH_QUEUE_BATCHES;
+        queue->head_offset = 0;
+        queue->filled--;
+        cond_signal(&queue->not_full);
+    }
+    mutex_unlock(&queue->mutex);
+    return count;
+}
+
+bool branch_queue_failed(BranchQueue* queue) {
+    mutex_lock(&queue->mutex);
+    bool failed = queue->failed;
+    mutex_unlock(&queue->mutex);
+    return failed;
+}
+
+void branch_queue_cancel(BranchQueue* queue) {
+    mutex_lock(&queue->mutex);
+    queue->closed = true;
+    cond_broadcast(&queue->not_full);
+    mutex_unlock(&queue->mutex);
+}
+
+static int queue_sink_write(void* context, const BranchRecord* record) {
+    return branch_queue_push((BranchQueue*)context, record);
+}
+
+static size_t queue_source_read(void* context, BranchRecord* records, size_t max_records) {
+    return branch_queue_pop((BranchQueue*)context, records, max_records);
+}
+
+BranchSink branch_queue_sink(BranchQueue* queue) {
+    BranchSink sink;
+    sink.context = queue;
+    sink.write = queue_sink_write;
+    return sink;
+}
+
+BranchSource branch_queue_source(BranchQueue* queue) {
+    BranchSource source;
+    source.context = queue;
+    source.read = queue_source_read;
+    return source;
+}
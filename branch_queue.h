@@ -0,0 +1,33 @@
+#ifndef BRANCH_QUEUE_H
+#define BRANCH_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "branch_trace.h"
+
+#define BRANCH_QUEUE_BATCH_SIZE 4096   // Records handed over per lock round trip
+#define BRANCH_QUEUE_BATCHES 8         // Bound on batches in flight between the two threads
+
+// Bounded single-producer/single-consumer ring buffer of branch record batches
+typedef struct BranchQueue BranchQueue;
+
+BranchQueue* branch_queue_create(void);
+void branch_queue_destroy(BranchQueue* queue);
+
+// Producer side; blocks while the ring is full. push returns 1 once the consumer cancelled the
+// queue, so the producer can stop instead of waiting for room that never comes.
+int branch_queue_push(BranchQueue* queue, const BranchRecord* record);
+void branch_queue_close(BranchQueue* queue, bool failed);
+
+// Consumer side; blocks until a batch is available, returns 0 once the producer closed the queue
+size_t branch_queue_pop(BranchQueue* queue, BranchRecord* records, size_t max_records);
+bool branch_queue_failed(BranchQueue* queue);
+
+// Consumer side; stops reading for good and wakes a producer blocked on a full ring
+void branch_queue_cancel(BranchQueue* queue);
+
+// Adapters so the queue can sit between the filter and the simulator
+BranchSink branch_queue_sink(BranchQueue* queue);
+BranchSource branch_queue_source(BranchQueue* queue);
+
+#endif
@@ -0,0 +1,236 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include "branch_trace.h"
+
+#define MAX_RECORD_BYTES 21 // 5 + 9 * 7 bits cover the address delta, then the kind and a 10-byte target
+#define KIND_COMPRESSED 0x10
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void put_u64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+}
+
+// Zigzag encoding of a signed difference, so short backward jumps stay short
+static uint64_t zigzag_encode(uint64_t difference) {
+    int64_t delta = (int64_t)difference;
+    return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+static uint64_t zigzag_decode(uint64_t zigzag) {
+    return (uint64_t)((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+}
+
+// Writes the low bits already packed into byte, then the remaining bits 7 at a time (LEB128)
+static uint8_t* put_varint(uint8_t* out, uint8_t byte, uint64_t rest) {
+    while (rest) {
+        *out++ = byte | 0x80;
+        byte = (uint8_t)(rest & 0x7F);
+        rest >>= 7;
+    }
+    *out++ = byte;
+    return out;
+}
+
+// Decodes a value whose lowest bits sit in bits low_bit..6 of first, followed by continuation bytes
+static const uint8_t* get_varint(const uint8_t* in, const uint8_t* end, uint8_t first, int low_bit, uint64_t* value) {
+    uint64_t result = (uint64_t)(first & 0x7F) >> low_bit;
+    int shift = 7 - low_bit;
+    uint8_t byte = first;
+    while ((byte & 0x80) && in < end) {
+        byte = *in++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    }
+    *value = result;
+    return in;
+}
+
+static int write_header(FILE* file, uint64_t record_count, const char* source) {
+    uint32_t source_length = (uint32_t)strlen(source);
+    if (source_length >= BRANCH_TRACE_MAX_SOURCE) source_length = BRANCH_TRACE_MAX_SOURCE - 1;
+
+    uint8_t header[20];
+    memcpy(header, BRANCH_TRACE_MAGIC, 4);
+    put_u32(header + 4, BRANCH_TRACE_VERSION);
+    put_u64(header + 8, record_count);
+    put_u32(header + 16, source_length);
+
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) return 1;
+    if (fwrite(source, 1, source_length, file) != source_length) return 1;
+    return 0;
+}
+
+static int flush_writer(BranchTraceWriter* writer) {
+    if (writer->buffer_used > 0 && fwrite(writer->buffer, 1, writer->buffer_used, writer->file) != writer->buffer_used) {
+        perror("Failed to write branch trace");
+        return 1;
+    }
+    writer->buffer_used = 0;
+    return 0;
+}
+
+int branch_trace_open_writer(BranchTraceWriter* writer, const char* path, const char* source) {
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        perror("Error opening output file");
+        return 1;
+    }
+    writer->record_count = 0;
+    writer->last_address = 0;
+    writer->buffer_used = 0;
+
+    // The record count is not known yet, it is patched in by branch_trace_close_writer
+    if (write_header(writer->file, 0, source)) {
+        perror("Failed to write branch trace header");
+        fclose(writer->file);
+        return 1;
+    }
+    return 0;
+}
+
+int branch_trace_write(BranchTraceWriter* writer, const BranchRecord* record) {
+    if (writer->buffer_used + MAX_RECORD_BYTES > sizeof(writer->buffer) && flush_writer(writer)) {
+        return 1;
+    }
+
+    // The common case, a 4-byte conditional branch, needs no kind byte
+    bool kind_byte = record->kind != BRANCH_CONDITIONAL || record->compressed;
+    uint64_t zigzag = zigzag_encode(record->address - writer->last_address);
+    uint8_t* out = writer->buffer + writer->buffer_used;
+
+    uint8_t byte = (uint8_t)((record->taken ? 1 : 0) | (kind_byte ? 2 : 0) | ((zigzag & 0x1F) << 2));
+    out = put_varint(out, byte, zigzag >> 5);
+    if (kind_byte) {
+        *out++ = (uint8_t)(record->kind | (record->compressed ? KIND_COMPRESSED : 0));
+    }
+    if (record->taken) {
+        zigzag = zigzag_encode(record->target - record->address);
+        out = put_varint(out, (uint8_t)(zigzag & 0x7F), zigzag >> 7);
+    }
+
+    writer->buffer_used = out - writer->buffer;
+    writer->last_address = record->address;
+    writer->record_count++;
+    return 0;
+}
+
+int branch_trace_close_writer(BranchTraceWriter* writer) {
+    int result = flush_writer(writer);
+
+    // Patch the final record count into the header
+    uint8_t count[8];
+    put_u64(count, writer->record_count);
+    if (result == 0 && (fseek(writer->file, 8, SEEK_SET) != 0 || fwrite(count, 1, sizeof(count), writer->file) != sizeof(count))) {
+        perror("Failed to finalize branch trace header");
+        result = 1;
+    }
+
+    if (fclose(writer->file) != 0) result = 1;
+    return result;
+}
+
+int branch_trace_open_reader(BranchTraceReader* reader, const char* path) {
+    if (map_file(&reader->file, path)) {
+        return 1;
+    }
+
+    const uint8_t* header = (const uint8_t*)reader->file.data;
+    if (reader->file.size < 20 || memcmp(header, BRANCH_TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not a branch trace file\n", path);
+        unmap_file(&reader->file);
+        return 1;
+    }
+    if (get_u32(header + 4) != BRANCH_TRACE_VERSION) {
+        fprintf(stderr, "%s has unsupported branch trace version %u\n", path, get_u32(header + 4));
+        unmap_file(&reader->file);
+        return 1;
+    }
+
+    reader->record_count = get_u64(header + 8);
+    uint32_t source_length = get_u32(header + 16);
+    if (source_length >= sizeof(reader->source) || reader->file.size - 20 < source_length) {
+        fprintf(stderr, "%s has a corrupt branch trace header\n", path);
+        unmap_file(&reader->file);
+        return 1;
+    }
+    memcpy(reader->source, header + 20, source_length);
+    reader->source[source_length] = '\0';
+
+    reader->records_read = 0;
+    reader->last_address = 0;
+    reader->pos = header + 20 + source_length;
+    reader->end = header + reader->file.size;
+    return 0;
+}
+
+bool branch_trace_read(BranchTraceReader* reader, BranchRecord* record) {
+    if (reader->records_read == reader->record_count) {
+        return false;
+    }
+
+    const uint8_t* in = reader->pos;
+    const uint8_t* end = reader->end;
+    if (in == end) {
+        fprintf(stderr, "Branch trace %s ended after %llu of %llu records\n", reader->source,
+            (unsigned long long)reader->records_read, (unsigned long long)reader->record_count);
+        reader->record_count = reader->records_read;
+        return false;
+    }
+
+    uint8_t byte = *in++;
+    bool taken = byte & 1;
+    uint64_t zigzag;
+    in = get_varint(in, end, byte, 2, &zigzag);
+    reader->last_address += zigzag_decode(zigzag);
+
+    record->kind = BRANCH_CONDITIONAL;
+    record->compressed = false;
+    if ((byte & 2) && in < end) {
+        uint8_t kind = *in++;
+        record->kind = (kind & 0x0F) < BRANCH_KIND_COUNT ? (BranchKind)(kind & 0x0F) : BRANCH_NONE;
+        record->compressed = (kind & KIND_COMPRESSED) != 0;
+    }
+    record->target = reader->last_address + (record->compressed ? 2 : 4); // Falls through when not taken
+    if (taken && in < end) {
+        uint8_t first = *in++;
+        in = get_varint(in, end, first, 0, &zigzag);
+        record->target = reader->last_address + zigzag_decode(zigzag);
+    }
+
+    reader->pos = in;
+    reader->records_read++;
+    record->address = reader->last_address;
+    record->taken = taken;
+    return true;
+}
+
+size_t branch_trace_read_batch(BranchTraceReader* reader, BranchRecord* records, size_t max_records) {
+    size_t count = 0;
+    while (count < max_records && branch_trace_read(reader, &records[count])) {
+        count++;
+    }
+    return count;
+}
+
+void branch_trace_close_reader(BranchTraceReader* reader) {
+    unmap_file(&reader->file);
+}
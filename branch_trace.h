@@ -0,0 +1,78 @@
+#ifndef BRANCH_TRACE_H
+#define BRANCH_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "branch_classifier.h"
+#include "mapped_file.h"
+
+// Binary branch trace produced by the filter stage and consumed by the predictors.
+//
+// File layout (all integers little-endian):
+//   magic "BTRC" | uint32 version | uint64 record_count | uint32 source_length | source path bytes
+// followed by record_count variable-length records. Each record stores the zigzag-encoded
+// delta from the previous branch address together with the taken bit and a kind flag:
+//   first byte:  bit 0 = taken, bit 1 = a kind byte follows, bits 2..6 = low 5 bits of the
+//                delta, bit 7 = continuation
+//   next bytes:  7 more delta bits each (LEB128), bit 7 = continuation
+//   kind byte:   for every record but a 4-byte conditional branch, the BranchKind of the record in
+//                bits 0..3 and the compressed flag in bit 4
+//   target:      only for taken records, the zigzag-encoded target minus the branch address (LEB128)
+// A not-taken record falls through to the branch address + 2 when compressed, + 4 otherwise.
+
+#define BRANCH_TRACE_MAGIC "BTRC"
+#define BRANCH_TRACE_VERSION 3
+#define BRANCH_TRACE_MAX_SOURCE 1024
+#define BRANCH_TRACE_BUFFER_SIZE (1 << 16)
+
+typedef struct {
+    uint64_t address;       // Address of the branch instruction
+    uint64_t target;        // Address of the instruction executed next
+    bool taken;             // Actual outcome of the branch
+    bool compressed;        // 2-byte instruction: falls through or returns to address + 2
+    BranchKind kind;
+} BranchRecord;
+
+// Push side of a record stream: the filter writes every resolved branch to a sink
+typedef struct {
+    void* context;
+    int (*write)(void* context, const BranchRecord* record);
+} BranchSink;
+
+// Pull side of a record stream: the simulator reads records from a source batch by batch.
+// read returns the number of records stored, 0 once the stream is exhausted.
+typedef struct {
+    void* context;
+    size_t (*read)(void* context, BranchRecord* records, size_t max_records);
+} BranchSource;
+
+typedef struct {
+    FILE* file;
+    uint64_t record_count;
+    uint64_t last_address;
+    size_t buffer_used;
+    uint8_t buffer[BRANCH_TRACE_BUFFER_SIZE];
+} BranchTraceWriter;
+
+// Records are decoded straight out of a read-only mapping of the file
+typedef struct {
+    MappedFile file;
+    char source[BRANCH_TRACE_MAX_SOURCE];   // Trace the records were filtered from
+    uint64_t record_count;                  // Number of records announced by the header
+    uint64_t records_read;
+    uint64_t last_address;
+    const uint8_t* pos;
+    const uint8_t* end;
+} BranchTraceReader;
+
+int branch_trace_open_writer(BranchTraceWriter* writer, const char* path, const char* source);
+int branch_trace_write(BranchTraceWriter* writer, const BranchRecord* record);
+int branch_trace_close_writer(BranchTraceWriter* writer);
+
+int branch_trace_open_reader(BranchTraceReader* reader, const char* path);
+bool branch_trace_read(BranchTraceReader* reader, BranchRecord* record);
+size_t branch_trace_read_batch(BranchTraceReader* reader, BranchRecord* records, size_t max_records);
+void branch_trace_close_reader(BranchTraceReader* reader);
+
+#endif
@@ -0,0 +1,321 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "aligned_memory.h"
+#include "btb.h"
+#include "checkpoint.h"
+#include "counter_table.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HAVE_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2 1
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define SRRIP_MAX_RRPV 3        // Distant re-reference, the next victim
+#define SRRIP_INSERT_RRPV 2     // New entries are predicted a long re-reference interval
+
+static const char* replacement_names[] = { "lru", "plru", "random", "srrip" };
+
+static unsigned lowest_set_bit(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+static bool is_power_of_two(int value) {
+    return value > 0 && (value & (value - 1)) == 0;
+}
+
+static uint64_t* set_tags(const BTBSet* set) {
+    return (uint64_t*)set;
+}
+
+static uint8_t* set_replacement(const BTB* btb, BTBSet* set) {
+    return (uint8_t*)set + btb->replacement_offset;
+}
+
+static size_t replacement_bytes(BTBReplacement replacement, int ways) {
+    switch (replacement) {
+        case BTB_REPLACE_LRU: return (size_t)ways * sizeof(uint64_t);
+        case BTB_REPLACE_PLRU: return ((size_t)ways + 7) / 8;  // One bit per tree node
+        case BTB_REPLACE_SRRIP: return (size_t)ways;
+        default: return 0;
+    }
+}
+
+int btb_replacement_from_name(const char* name, BTBReplacement* replacement) {
+    for (int i = 0; i < (int)(sizeof(replacement_names) / sizeof(replacement_names[0])); i++) {
+        if (strcmp(name, replacement_names[i]) == 0) {
+            *replacement = (BTBReplacement)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+const char* btb_replacement_name(BTBReplacement replacement) {
+    return replacement_names[replacement];
+}
+
+int btb_check_bhr_bits(int bhr_bits) {
+    if (bhr_bits < 0 || bhr_bits > BTB_MAX_BHR_BITS) {
+        fprintf(stderr, "bhr_bits must be between 0 and %d, not %d\n", BTB_MAX_BHR_BITS, bhr_bits);
+        return 1;
+    }
+    return 0;
+}
+
+uint64_t btb_storage_bits(const BTB* btb, int bhr_bits) {
+    uint64_t entry_bits = (uint64_t)(64 - btb->index_bits) + 1 + bhr_bits + 2 * (uint64_t)btb->counters_per_entry
+        + (btb->has_targets ? 64 : 0); // Full target addresses
+    uint64_t way_bits = 0;
+    while ((1 << way_bits) < btb->ways) way_bits++;
+
+    uint64_t set_bits;
+    switch (btb->replacement) {
+        case BTB_REPLACE_LRU: set_bits = btb->ways * way_bits; break;     // A recency rank per way
+        case BTB_REPLACE_PLRU: set_bits = btb->ways - 1; break;          // One bit per tree node
+        case BTB_REPLACE_SRRIP: set_bits = 2 * (uint64_t)btb->ways; break;
+        default: set_bits = 0; break;
+    }
+    return (uint64_t)btb->btb_sets * (btb->ways * entry_bits + set_bits);
+}
+
+int btb_init(BTB* btb, int btb_entries, int ways, BTBReplacement replacement, int counters_per_entry, bool targets) {
+    if (ways < 1 || btb_entries % ways != 0 || !is_power_of_two(btb_entries / ways)) {
+        fprintf(stderr, "Invalid BTB geometry: %d entries in %d ways\n", btb_entries, ways);
+        return 1;
+    }
+    if (replacement == BTB_REPLACE_PLRU && !is_power_of_two(ways)) {
+        fprintf(stderr, "Tree PLRU replacement needs a power-of-two number of ways, not %d\n", ways);
+        return 1;
+    }
+
+    btb->btb_sets = btb_entries / ways;
+    btb->index_bits = (int)(log2(btb->btb_sets));
+    btb->ways = ways;
+    btb->tag_slots = (ways + BTB_TAG_LANES - 1) / BTB_TAG_LANES * BTB_TAG_LANES;
+    btb->counters_per_entry = counters_per_entry;
+    btb->has_targets = targets;
+    btb->entry_counter_bytes = COUNTER_BYTES(counters_per_entry);
+    btb->replacement = replacement;
+    btb->clock = 0;
+    btb->random_state = 0x9e3779b97f4a7c15ULL;
+
+    // Tags first so they stay 32-byte aligned for the vector compares
+    btb->targets_offset = (size_t)btb->tag_slots * sizeof(uint64_t);
+    btb->replacement_offset = btb->targets_offset + (targets ? (size_t)ways * sizeof(uint64_t) : 0);
+    btb->bhr_offset = (btb->replacement_offset + replacement_bytes(replacement, ways) + 1) & ~(size_t)1;
+    btb->counters_offset = btb->bhr_offset + (size_t)ways * sizeof(uint16_t);
+    size_t set_size = btb->counters_offset + (size_t)ways * btb->entry_counter_bytes;
+
+    // Round each set block up to whole cache lines so no set straddles two lines needlessly
+    btb->set_stride = (set_size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    btb->sets = (uint8_t*)alloc_cache_aligned((size_t)btb->btb_sets * btb->set_stride);
+    if (!btb->sets) {
+        perror("Failed to allocate memory for BTB sets");
+        return 1;
+    }
+
+    for (int i = 0; i < btb->btb_sets; i++) {
+        BTBSet* set = (BTBSet*)(btb->sets + (size_t)i * btb->set_stride);
+        memset(set_tags(set), 0xFF, btb->targets_offset); // All entries invalid
+        memset((uint8_t*)set + btb->targets_offset, 0, btb->counters_offset - btb->targets_offset);
+        if (replacement == BTB_REPLACE_SRRIP) {
+            memset(set_replacement(btb, set), SRRIP_MAX_RRPV, (size_t)ways);
+        }
+
+        // Initialize counters to 'weakly not taken' (01)
+        for (int way = 0; way < ways; way++) {
+            packed_counters_reset(btb_counters(btb, set, way), counters_per_entry);
+        }
+    }
+    return 0;
+}
+
+void btb_free(BTB* btb) {
+    free_cache_aligned(btb->sets);
+    btb->sets = NULL;
+}
+
+// Bytes of a set block in use; the padding up to set_stride is not checkpointed
+static size_t set_used_bytes(const BTB* btb) {
+    return btb->counters_offset + (size_t)btb->ways * btb->entry_counter_bytes;
+}
+
+int btb_save(const BTB* btb, FILE* file) {
+    if (checkpoint_write_u64(file, (uint64_t)btb->btb_sets)
+        || checkpoint_write_u64(file, (uint64_t)btb->ways)
+        || checkpoint_write_u64(file, (uint64_t)btb->counters_per_entry)
+        || checkpoint_write_u64(file, btb->has_targets ? 1 : 0)
+        || checkpoint_write_u64(file, (uint64_t)btb->replacement)
+        || checkpoint_write_u64(file, btb->clock)
+        || checkpoint_write_u64(file, btb->random_state)) {
+        return 1;
+    }
+    for (int i = 0; i < btb->btb_sets; i++) {
+        if (checkpoint_write(file, btb->sets + (size_t)i * btb->set_stride, set_used_bytes(btb))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int btb_load(BTB* btb, FILE* file) {
+    if (checkpoint_expect(file, (uint64_t)btb->btb_sets, "BTB sets")
+        || checkpoint_expect(file, (uint64_t)btb->ways, "BTB ways")
+        || checkpoint_expect(file, (uint64_t)btb->counters_per_entry, "BTB counters per entry")
+        || checkpoint_expect(file, btb->has_targets ? 1 : 0, "BTB targets")
+        || checkpoint_expect(file, (uint64_t)btb->replacement, "BTB replacement policy")
+        || checkpoint_read_u64(file, &btb->clock)
+        || checkpoint_read_u64(file, &btb->random_state)) {
+        return 1;
+    }
+    for (int i = 0; i < btb->btb_sets; i++) {
+        if (checkpoint_read(file, btb->sets + (size_t)i * btb->set_stride, set_used_bytes(btb))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Compares the tag against BTB_TAG_LANES ways per step; the padding ways never match
+int btb_find(const BTB* btb, const BTBSet* set, uint64_t tag) {
+    const uint64_t* tags = set_tags(set);
+    int slots = btb->tag_slots;
+
+#if defined(HAVE_AVX2)
+    const __m256i key = _mm256_set1_epi64x((long long)tag);
+    for (int way = 0; way < slots; way += 4) {
+        __m256i lanes = _mm256_load_si256((const __m256i*)(tags + way));
+        unsigned mask = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lanes, key)));
+        if (mask) return way + (int)lowest_set_bit(mask);
+    }
+#elif defined(HAVE_SSE2)
+    // SSE2 has no 64-bit compare: a lane matches when both of its 32-bit halves do
+    const __m128i key = _mm_set1_epi64x((long long)tag);
+    for (int way = 0; way < slots; way += 2) {
+        __m128i halves = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(tags + way)), key);
+        __m128i lanes = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+        unsigned mask = (unsigned)_mm_movemask_pd(_mm_castsi128_pd(lanes));
+        if (mask) return way + (int)lowest_set_bit(mask);
+    }
+#else
+    for (int way = 0; way < slots; way++) {
+        if (tags[way] == tag) return way;
+    }
+#endif
+    return -1;
+}
+
+static uint64_t next_random(BTB* btb) {
+    uint64_t x = btb->random_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    btb->random_state = x;
+    return x;
+}
+
+// Tree PLRU: node n (1-based, heap order) has children 2n and 2n+1, leaf ways + w is way w.
+// A node's bit names the child subtree that was used least recently.
+static int plru_victim(const BTB* btb, const uint8_t* bits) {
+    int node = 1;
+    while (node < btb->ways) {
+        node = 2 * node + ((bits[node >> 3] >> (node & 7)) & 1);
+    }
+    return node - btb->ways;
+}
+
+static void plru_touch(const BTB* btb, uint8_t* bits, int way) {
+    for (int node = btb->ways + way; node > 1; node >>= 1) {
+        int parent = node >> 1;
+        uint8_t bit = (uint8_t)(1 << (parent & 7));
+        // Point the parent away from the subtree that was just used
+        if (node & 1) bits[parent >> 3] &= (uint8_t)~bit;
+        else bits[parent >> 3] |= bit;
+    }
+}
+
+static int srrip_victim(const BTB* btb, uint8_t* rrpv) {
+    for (;;) {
+        for (int way = 0; way < btb->ways; way++) {
+            if (rrpv[way] == SRRIP_MAX_RRPV) return way;
+        }
+        // Nothing is predicted distant yet: age every entry and look again
+        for (int way = 0; way < btb->ways; way++) {
+            rrpv[way]++;
+        }
+    }
+}
+
+static int lru_victim(const BTB* btb, const uint64_t* stamps) {
+    int victim = 0;
+    for (int way = 1; way < btb->ways; way++) {
+        if (stamps[way] < stamps[victim]) victim = way;
+    }
+    return victim;
+}
+
+void btb_touch(BTB* btb, BTBSet* set, int way) {
+    uint8_t* state = set_replacement(btb, set);
+
+    switch (btb->replacement) {
+        case BTB_REPLACE_LRU:
+            ((uint64_t*)state)[way] = ++btb->clock;
+            break;
+        case BTB_REPLACE_PLRU:
+            plru_touch(btb, state, way);
+            break;
+        case BTB_REPLACE_SRRIP:
+            state[way] = 0; // Re-referenced: predict a near-immediate reuse
+            break;
+        default:
+            break;
+    }
+}
+
+int btb_replace(BTB* btb, BTBSet* set, uint64_t tag) {
+    uint8_t* state = set_replacement(btb, set);
+
+    // Fill invalid ways before evicting anything
+    int way = btb_find(btb, set, BTB_INVALID_TAG);
+    if (way < 0 || way >= btb->ways) {
+        switch (btb->replacement) {
+            case BTB_REPLACE_LRU: way = lru_victim(btb, (const uint64_t*)state); break;
+            case BTB_REPLACE_PLRU: way = plru_victim(btb, state); break;
+            case BTB_REPLACE_SRRIP: way = srrip_victim(btb, state); break;
+            default: way = (int)(next_random(btb) % (uint64_t)btb->ways); break;
+        }
+    }
+
+    // Initialize the new entry with the branch data
+    set_tags(set)[way] = tag;
+    if (btb->has_targets) {
+        *btb_target(btb, set, way) = 0; // Target unknown until the branch is taken
+    }
+    *btb_bhr(btb, set, way) = 0; // Start with no history
+    packed_counters_reset(btb_counters(btb, set, way), btb->counters_per_entry); // Initialize counters to 'weakly not taken' (01)
+
+    if (btb->replacement == BTB_REPLACE_SRRIP) {
+        state[way] = SRRIP_INSERT_RRPV;
+    }
+    else {
+        btb_touch(btb, set, way);
+    }
+    return way;
+}
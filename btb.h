@@ -0,0 +1,125 @@
+#ifndef BTB_H
+#define BTB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "aligned_memory.h"
+
+#define BTB_DEFAULT_WAYS 2  // 2-way set associative (2 entries per set)
+#define BTB_MAX_BHR_BITS 16  // Width of the per-entry branch history registers
+#define BTB_TAG_LANES 4     // Tags are compared four at a time, so each set stores a multiple of four
+
+// Never a real tag: branch addresses are even, and any index bits shift the tag below 2^64 - 1
+#define BTB_INVALID_TAG UINT64_MAX
+
+typedef enum {
+    BTB_REPLACE_LRU = 0,    // True LRU, from per-way access stamps
+    BTB_REPLACE_PLRU,       // Tree pseudo-LRU, needs a power-of-two number of ways
+    BTB_REPLACE_RANDOM,
+    BTB_REPLACE_SRRIP       // Static re-reference interval prediction with 2-bit RRPVs
+} BTBReplacement;
+
+// One BTB set. Each set is a cache-line aligned block of set_stride bytes laid out as a
+// structure of arrays:
+//   uint64_t tags[tag_slots] | uint64_t targets[ways] | replacement state | uint16_t bhr[ways] | packed counters per way
+// The targets array is only present in BTBs created to keep branch targets.
+// Invalid ways (and the padding up to tag_slots) hold BTB_INVALID_TAG, so a lookup is a plain
+// compare of the tag array. The private 2-bit counters of the entries (if any, packed as in
+// counter_table.h) live in the same block, so a lookup touches a single contiguous region.
+typedef struct BTBSet BTBSet;
+
+typedef struct {
+    uint8_t* sets;              // btb_sets blocks of set_stride bytes, allocated once
+    size_t set_stride;
+    size_t targets_offset;      // Offsets of the arrays inside a set block
+    size_t replacement_offset;
+    size_t bhr_offset;
+    size_t counters_offset;
+    size_t entry_counter_bytes; // Bytes of packed counters per entry
+    int btb_sets;
+    int index_bits;
+    int ways;
+    int tag_slots;              // ways rounded up to BTB_TAG_LANES
+    int counters_per_entry;     // Private counters per entry, 0 when the counters are shared
+    bool has_targets;           // Entries keep the last taken target of their branch
+    BTBReplacement replacement;
+    uint64_t clock;             // LRU access stamp source
+    uint64_t random_state;      // xorshift state for random replacement
+} BTB;
+
+// Allocates the whole BTB in one block; all entries start invalid with counters 'weakly not taken'.
+// ways ranges from 1 (direct-mapped) to btb_entries (fully associative). With targets every entry
+// also keeps a branch target (see btb_target).
+int btb_init(BTB* btb, int btb_entries, int ways, BTBReplacement replacement, int counters_per_entry, bool targets);
+void btb_free(BTB* btb);
+
+// Checkpoint every set, the LRU clock and the random state; loading fails unless the geometry,
+// counters per entry, targets and replacement policy match the saved BTB
+int btb_save(const BTB* btb, FILE* file);
+int btb_load(BTB* btb, FILE* file);
+
+// Rejects per-entry histories wider than BTB_MAX_BHR_BITS; returns 0 when bhr_bits fits
+int btb_check_bhr_bits(int bhr_bits);
+
+// Hardware budget of the BTB: tags, valid bits, targets, histories, private counters and replacement state
+uint64_t btb_storage_bits(const BTB* btb, int bhr_bits);
+
+// Bytes the simulator allocated for the sets
+static inline uint64_t btb_memory_bytes(const BTB* btb) {
+    return (uint64_t)btb->btb_sets * btb->set_stride;
+}
+
+// Parses "lru", "plru", "random" or "srrip"; returns 1 for anything else
+int btb_replacement_from_name(const char* name, BTBReplacement* replacement);
+const char* btb_replacement_name(BTBReplacement replacement);
+
+static inline uint64_t btb_tag(const BTB* btb, uint64_t address) {
+    return address >> btb->index_bits;
+}
+
+static inline BTBSet* btb_set(const BTB* btb, uint64_t address) {
+    uint64_t index = address & ((1ULL << btb->index_bits) - 1);
+    return (BTBSet*)(btb->sets + index * btb->set_stride);
+}
+
+// Starts loading the tags and histories of the set address maps to, ahead of its lookup
+static inline void btb_prefetch(const BTB* btb, uint64_t address) {
+    const uint8_t* set = (const uint8_t*)btb_set(btb, address);
+    PREFETCH(set);
+    PREFETCH(set + btb->bhr_offset);
+}
+
+// Branch history register of the entry in way
+static inline uint16_t* btb_bhr(const BTB* btb, BTBSet* set, int way) {
+    return (uint16_t*)((uint8_t*)set + btb->bhr_offset) + way;
+}
+
+// Packed counters of the entry in way, for use with packed_counter_predict/update
+static inline uint8_t* btb_counters(const BTB* btb, BTBSet* set, int way) {
+    return (uint8_t*)set + btb->counters_offset + (size_t)way * btb->entry_counter_bytes;
+}
+
+// Target of the entry in way, 0 until a taken outcome of its branch was recorded; BTBs with targets only
+static inline uint64_t* btb_target(const BTB* btb, BTBSet* set, int way) {
+    return (uint64_t*)((uint8_t*)set + btb->targets_offset) + way;
+}
+
+// Returns the way holding tag, or -1 on a miss
+int btb_find(const BTB* btb, const BTBSet* set, uint64_t tag);
+
+// True when every way of the set holds a valid entry, so a replacement would evict one
+static inline bool btb_set_full(const BTB* btb, const BTBSet* set) {
+    int way = btb_find(btb, set, BTB_INVALID_TAG);
+    return way < 0 || way >= btb->ways;
+}
+
+// Records a hit on way for the replacement policy
+void btb_touch(BTB* btb, BTBSet* set, int way);
+
+// Installs tag in an invalid way or the policy's victim, with no history and fresh counters;
+// returns the way
+int btb_replace(BTB* btb, BTBSet* set, uint64_t tag);
+
+#endif
@@ -0,0 +1,50 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "checkpoint.h"
+
+int checkpoint_write(FILE* file, const void* data, size_t size) {
+    if (fwrite(data, 1, size, file) != size) {
+        perror("Failed to write checkpoint");
+        return 1;
+    }
+    return 0;
+}
+
+int checkpoint_read(FILE* file, void* data, size_t size) {
+    if (fread(data, 1, size, file) != size) {
+        fprintf(stderr, "Checkpoint is truncated or unreadable\n");
+        return 1;
+    }
+    return 0;
+}
+
+int checkpoint_write_u64(FILE* file, uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = (uint8_t)(value >> (8 * i));
+    return checkpoint_write(file, bytes, sizeof(bytes));
+}
+
+int checkpoint_read_u64(FILE* file, uint64_t* value) {
+    uint8_t bytes[8];
+    if (checkpoint_read(file, bytes, sizeof(bytes))) {
+        return 1;
+    }
+    *value = 0;
+    for (int i = 0; i < 8; i++) *value |= (uint64_t)bytes[i] << (8 * i);
+    return 0;
+}
+
+int checkpoint_expect(FILE* file, uint64_t expected, const char* what) {
+    uint64_t value;
+    if (checkpoint_read_u64(file, &value)) {
+        return 1;
+    }
+    if (value != expected) {
+        fprintf(stderr, "Checkpoint was saved with %s = %llu, the configuration has %llu\n",
+            what, (unsigned long long)value, (unsigned long long)expected);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Predictor checkpoint: "BPCK", u64 version, u64 predictor count, then for every predictor its
+// name (u64 length + bytes), whatever its PredictorType.save wrote and a u64 flag followed, when
+// set, by the state of its target predictor. Integers are
+// little-endian; bulk state (packed counters, BTB set blocks) is copied as laid out in memory.
+// Every component writes the sizes it was built with first, so restoring into a predictor of a
+// different configuration fails instead of silently misreading the state.
+#define CHECKPOINT_MAGIC "BPCK"
+#define CHECKPOINT_VERSION 3
+
+// All helpers return 0 on success and report the failure on stderr otherwise
+int checkpoint_write(FILE* file, const void* data, size_t size);
+int checkpoint_read(FILE* file, void* data, size_t size);
+int checkpoint_write_u64(FILE* file, uint64_t value);
+int checkpoint_read_u64(FILE* file, uint64_t* value);
+
+// Reads a size written by the saving predictor and fails unless it equals the current one
+int checkpoint_expect(FILE* file, uint64_t expected, const char* what);
+
+#endif
@@ -0,0 +1,246 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "config.h"
+
+// Function to trim whitespace from the beginning and end of a string
+char* trim_whitespace(char* str) {
+   
+    while (isspace((unsigned char)*str)) str++;
+    char* end = str + strlen(str) - 1;
+    
+    while (end > str && isspace((unsigned char)*end)) end--;
+    *(end + 1) = '\0';
+
+    return str;
+}
+
+// Values end at the ';' that precedes the trailing "rem" comment
+static char* strip_comment(char* value) {
+    char* end = strchr(value, ';');
+    if (end) *end = '\0';
+    return trim_whitespace(value);
+}
+
+static void add_value(ParameterValues* values, int value) {
+    if (values->count == MAX_PARAMETER_VALUES) {
+        fprintf(stderr, "Too many configuration values, ignoring %d\n", value);
+        return;
+    }
+    values->values[values->count++] = value;
+}
+
+static void set_path(char* path, char* value) {
+    strncpy(path, strip_comment(value), CONFIG_PATH_LENGTH - 1);
+    path[CONFIG_PATH_LENGTH - 1] = '\0';
+}
+
+// Parses "6", "4,6,8", "4..12", "4..12:2" or "512..65536*2"
+static void parse_values(char* value, ParameterValues* values) {
+    values->count = 0;
+
+    for (char* item = strtok(strip_comment(value), ","); item; item = strtok(NULL, ",")) {
+        char* range = strstr(item, "..");
+        if (!range) {
+            add_value(values, atoi(item));
+            continue;
+        }
+
+        int first = atoi(item);
+        int last = atoi(range + 2);
+        char* step_text = strpbrk(range + 2, ":*");
+        int step = step_text ? atoi(step_text + 1) : 1;
+        bool multiply = step_text && *step_text == '*';
+
+        if (step < (multiply ? 2 : 1) || first > last || (multiply && first <= 0)) {
+            fprintf(stderr, "Invalid configuration range: %s\n", item);
+            exit(EXIT_FAILURE);
+        }
+        for (long long current = first; current <= last; current = multiply ? current * step : current + step) {
+            add_value(values, (int)current);
+        }
+    }
+
+    if (values->count == 0) {
+        fprintf(stderr, "Missing configuration value\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Assigns one "key = value" setting; returns 1 for an unknown key
+static int apply_setting(Config* config, const char* key, char* value) {
+    if (strcmp(key, "ghr_bits") == 0) {
+        parse_values(value, &config->ghr_bits);
+    }
+    else if (strcmp(key, "bhr_bits") == 0) {
+        parse_values(value, &config->bhr_bits);
+    }
+    else if (strcmp(key, "entries") == 0) {
+        parse_values(value, &config->entries);
+    }
+    else if (strcmp(key, "pht_bits") == 0) {
+        config->pht_bits = atoi(value);
+    }
+    else if (strcmp(key, "btb_ways") == 0) {
+        config->btb_ways = atoi(value);
+    }
+    else if (strcmp(key, "btb_replacement") == 0) {
+        if (btb_replacement_from_name(strip_comment(value), &config->btb_replacement)) {
+            fprintf(stderr, "Unknown BTB replacement policy: %s\n", value);
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if (strcmp(key, "chooser_bits") == 0) {
+        config->chooser_bits = atoi(value);
+    }
+    else if (strcmp(key, "chooser_index") == 0) {
+        if (chooser_index_from_name(strip_comment(value), &config->chooser_index)) {
+            fprintf(stderr, "Unknown chooser index: %s\n", value);
+            exit(EXIT_FAILURE);
+        }
+    }
+    else if (strcmp(key, "which_predictor") == 0) {
+        config->which_predictor = atoi(value);
+    }
+    else if (strcmp(key, "streaming") == 0) {
+        config->streaming = atoi(value);
+    }
+    else if (strcmp(key, "threads") == 0) {
+        config->threads = atoi(value);
+    }
+    else if (strcmp(key, "sweep_output") == 0) {
+        set_path(config->sweep_output, value);
+    }
+    else if (strcmp(key, "warmup_branches") == 0) {
+        config->warmup_branches = strtoull(strip_comment(value), NULL, 10);
+    }
+    else if (strcmp(key, "checkpoint_in") == 0) {
+        set_path(config->checkpoint_in, value);
+    }
+    else if (strcmp(key, "checkpoint_out") == 0) {
+        set_path(config->checkpoint_out, value);
+    }
+    else if (strcmp(key, "profile_top") == 0) {
+        config->profile_top = atoi(value);
+    }
+    else if (strcmp(key, "profile_csv") == 0) {
+        set_path(config->profile_csv, value);
+    }
+    else if (strcmp(key, "benchmark") == 0) {
+        config->benchmark = strtoull(strip_comment(value), NULL, 10);
+    }
+    else if (strcmp(key, "benchmark_seed") == 0) {
+        config->benchmark_seed = strtoull(strip_comment(value), NULL, 10);
+    }
+    else if (strcmp(key, "shards") == 0) {
+        config->shards = atoi(value);
+    }
+    else if (strcmp(key, "shard_warmup") == 0) {
+        config->shard_warmup = strtoull(strip_comment(value), NULL, 10);
+    }
+    else if (strcmp(key, "filtered_dir") == 0) {
+        set_path(config->filtered_dir, value);
+    }
+    else if (strcmp(key, "filter_cache") == 0) {
+        set_path(config->filter_cache, value);
+    }
+    else if (strcmp(key, "targets") == 0) {
+        config->targets = atoi(value);
+    }
+    else if (strcmp(key, "indirect_bits") == 0) {
+        config->indirect_bits = atoi(value);
+    }
+    else if (strcmp(key, "ras_depth") == 0) {
+        config->ras_depth = atoi(value);
+    }
+    else if (strcmp(key, "results_output") == 0) {
+        set_path(config->results_output, value);
+    }
+    else {
+        return 1;
+    }
+    return 0;
+}
+
+static void set_defaults(Config* config) {
+    memset(config, 0, sizeof(*config));
+    config->btb_ways = BTB_DEFAULT_WAYS;
+    config->btb_replacement = BTB_REPLACE_LRU;
+    config->chooser_bits = DEFAULT_CHOOSER_BITS;
+    config->chooser_index = CHOOSER_INDEX_PC;
+    config->shard_warmup = DEFAULT_SHARD_WARMUP;
+    config->benchmark_seed = DEFAULT_BENCHMARK_SEED;
+    config->indirect_bits = DEFAULT_INDIRECT_BITS;
+    config->ras_depth = DEFAULT_RAS_DEPTH;
+}
+
+// Function to read configuration from a file and set variables
+void read_config(Config* config, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror("Failed to open configuration file");
+        exit(EXIT_FAILURE);
+    }
+
+    set_defaults(config);
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || strlen(trim_whitespace(line)) == 0) {
+            continue;
+        }
+
+        char* key = strtok(line, "=");
+        char* value = strtok(NULL, "=");
+
+        if (key && value) {
+            key = trim_whitespace(key);
+            value = trim_whitespace(value);
+
+            if (apply_setting(config, key, value)) {
+                printf("Unknown configuration key: %s\n", key);
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+int config_override(Config* config, const char* assignment) {
+    char line[256];
+    strncpy(line, assignment, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    char* separator = strchr(line, '=');
+    if (!separator) {
+        fprintf(stderr, "Configuration override must be key=value: %s\n", assignment);
+        return 1;
+    }
+    *separator = '\0';
+    char* key = trim_whitespace(line);
+    if (apply_setting(config, key, trim_whitespace(separator + 1))) {
+        fprintf(stderr, "Unknown configuration key: %s\n", key);
+        return 1;
+    }
+    return 0;
+}
+
+void config_predictor_sizing(const Config* config, int ghr_bits, int bhr_bits, int entries, PredictorConfig* sizing) {
+    sizing->ghr_bits = ghr_bits;
+    sizing->bhr_bits = bhr_bits;
+    sizing->pht_bits = config->pht_bits;
+    sizing->btb_entries = entries;
+    sizing->btb_ways = config->btb_ways;
+    sizing->btb_replacement = config->btb_replacement;
+    sizing->chooser_bits = config->chooser_bits;
+    sizing->chooser_index = config->chooser_index;
+    sizing->targets = false; // Only trace runs predict targets, see run_trace_job
+    sizing->indirect_bits = config->indirect_bits;
+    sizing->ras_depth = config->ras_depth;
+}
+
+bool config_is_sweep(const Config* config) {
+    return config->ghr_bits.count > 1 || config->bhr_bits.count > 1 || config->entries.count > 1;
+}
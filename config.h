@@ -0,0 +1,65 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "btb.h"
+#include "predictor.h"
+
+#define MAX_PARAMETER_VALUES 64
+#define CONFIG_PATH_LENGTH 256
+#define DEFAULT_SHARD_WARMUP 100000
+#define DEFAULT_BENCHMARK_SEED 1
+
+// A sized parameter; more than one value turns the run into a design-space sweep.
+// BTBConfiguration.txt accepts a single value, a list (4,6,8), an additive range (4..12 or 4..12:2)
+// or a multiplicative range (512..65536*2).
+typedef struct {
+    int values[MAX_PARAMETER_VALUES];
+    int count;
+} ParameterValues;
+
+typedef struct {
+    ParameterValues ghr_bits;
+    ParameterValues bhr_bits;
+    ParameterValues entries;
+    int pht_bits;                           // Index bits of global-history counter tables, 0 = ghr_bits up to 24
+    int btb_ways;                           // 1 = direct-mapped, entries = fully associative
+    BTBReplacement btb_replacement;
+    int chooser_bits;                       // Tournament chooser size, 2^chooser_bits counters
+    ChooserIndex chooser_index;             // pc, ghr or pc^ghr
+    int which_predictor;
+    int streaming;                          // Filter and predict concurrently, without writing *_filtered.bin files
+    int threads;                            // Jobs run in parallel, 0 = one per CPU
+    char sweep_output[CONFIG_PATH_LENGTH];  // Sweep results file, .json for JSON, anything else for CSV; empty = stdout
+    uint64_t warmup_branches;               // Leading branches of each trace that train the predictors uncounted
+    char checkpoint_in[CONFIG_PATH_LENGTH]; // Directory of <trace>.ckpt states to start from; empty = cold start
+    char checkpoint_out[CONFIG_PATH_LENGTH];// Directory to save each trace's final state to; empty = none
+    int profile_top;                        // Worst branches listed per predictor, 0 = none
+    char profile_csv[CONFIG_PATH_LENGTH];   // Directory to write <trace>.profile.csv to; empty = none
+    uint64_t benchmark;                     // Synthetic branches per benchmark pattern, 0 = simulate the traces
+    uint64_t benchmark_seed;
+    int shards;                             // Chunks of each trace simulated in parallel, 0 or 1 = exact serial run
+    uint64_t shard_warmup;                  // Branches before each chunk replayed uncounted to warm it up
+    char filtered_dir[CONFIG_PATH_LENGTH];  // Directory for <trace>_filtered.bin files; empty = next to the trace
+    char filter_cache[CONFIG_PATH_LENGTH];  // Directory of filtered traces reused by content hash; empty = none
+    int targets;                            // Predict branch and jump targets beside the directions
+    int indirect_bits;                      // Indirect target cache size, 2^indirect_bits entries
+    int ras_depth;                          // Return address stack entries, 0 = no stack
+    char results_output[CONFIG_PATH_LENGTH];// Results of trace runs, .json for JSON, anything else for CSV; empty = none
+} Config;
+
+// Function to read configuration from a file and set variables
+void read_config(Config* config, const char* path);
+
+// Applies a "key=value" setting on top of the file, e.g. from the command line; returns 1 when the
+// assignment is malformed or the key unknown
+int config_override(Config* config, const char* assignment);
+
+// Predictor sizing for one point of the ghr_bits x bhr_bits x entries space
+void config_predictor_sizing(const Config* config, int ghr_bits, int bhr_bits, int entries, PredictorConfig* sizing);
+
+// True when any sized parameter has more than one value
+bool config_is_sweep(const Config* config);
+
+#endif
@@ -0,0 +1,45 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "counter_table.h"
+
+// Four 'weakly not taken' (01) counters in one byte
+#define WEAKLY_NOT_TAKEN_BYTE 0x55
+
+void packed_counters_reset(uint8_t* bytes, size_t count) {
+    memset(bytes, WEAKLY_NOT_TAKEN_BYTE, count / COUNTERS_PER_BYTE);
+
+    // A partial last byte only has its low counters in use
+    for (size_t i = count - count % COUNTERS_PER_BYTE; i < count; i++) {
+        unsigned shift = (unsigned)(i % COUNTERS_PER_BYTE) * 2;
+        bytes[i / COUNTERS_PER_BYTE] = (uint8_t)((bytes[i / COUNTERS_PER_BYTE] & ~(3u << shift)) | (COUNTER_WEAKLY_NOT_TAKEN << shift));
+    }
+}
+
+int counter_table_init(CounterTable* table, size_t size) {
+    table->size = size;
+    table->counters = (uint8_t*)calloc(COUNTER_BYTES(size), 1);
+    if (!table->counters) {
+        perror("Failed to allocate memory for counter table");
+        return 1;
+    }
+    packed_counters_reset(table->counters, size);
+    return 0;
+}
+
+void counter_table_free(CounterTable* table) {
+    free(table->counters);
+    table->counters = NULL;
+}
+
+int counter_table_save(const CounterTable* table, FILE* file) {
+    return checkpoint_write_u64(file, table->size)
+        || checkpoint_write(file, table->counters, COUNTER_BYTES(table->size));
+}
+
+int counter_table_load(CounterTable* table, FILE* file) {
+    return checkpoint_expect(file, table->size, "counter table size")
+        || checkpoint_read(file, table->counters, COUNTER_BYTES(table->size));
+}
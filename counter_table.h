@@ -0,0 +1,62 @@
+#ifndef COUNTER_TABLE_H
+#define COUNTER_TABLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Tables of 2-bit saturating counters packed four to a byte: counter i lives in bits
+// 2 * (i % 4) .. 2 * (i % 4) + 1 of byte i / 4. The MSB of a counter is its prediction,
+// 00/01 predict not taken and 10/11 predict taken.
+
+#define COUNTER_WEAKLY_NOT_TAKEN 1
+#define COUNTERS_PER_BYTE 4
+#define COUNTER_BYTES(count) (((size_t)(count) + COUNTERS_PER_BYTE - 1) / COUNTERS_PER_BYTE)
+
+typedef struct {
+    uint8_t* counters;      // COUNTER_BYTES(size) bytes of packed counters
+    size_t size;            // Number of counters
+} CounterTable;
+
+// Allocates size counters, all 'weakly not taken' (01)
+int counter_table_init(CounterTable* table, size_t size);
+void counter_table_free(CounterTable* table);
+
+// Checkpoint the counters; loading fails unless the table has the size it was saved with
+int counter_table_save(const CounterTable* table, FILE* file);
+int counter_table_load(CounterTable* table, FILE* file);
+
+// Sets count packed counters starting at bytes to 'weakly not taken' (01)
+void packed_counters_reset(uint8_t* bytes, size_t count);
+
+static inline unsigned packed_counter_get(const uint8_t* bytes, size_t index) {
+    return (bytes[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+static inline bool packed_counter_predict(const uint8_t* bytes, size_t index) {
+    return packed_counter_get(bytes, index) >> 1; // MSB of the 2-bit counter
+}
+
+// Moves the counter one step towards taken (up) or not taken, saturating at 0 and 3,
+// without branching on the counter value
+static inline void packed_counter_update(uint8_t* bytes, size_t index, bool up) {
+    unsigned shift = (unsigned)(index & 3) * 2;
+    unsigned counter = (bytes[index >> 2] >> shift) & 3;
+    unsigned next = counter + (up & (counter != 3)) - (!up & (counter != 0));
+    bytes[index >> 2] ^= (uint8_t)((counter ^ next) << shift);
+}
+
+static inline uint64_t counter_table_bytes(const CounterTable* table) {
+    return COUNTER_BYTES(table->size);
+}
+
+static inline bool counter_table_predict(const CounterTable* table, size_t index) {
+    return packed_counter_predict(table->counters, index);
+}
+
+static inline void counter_table_update(CounterTable* table, size_t index, bool up) {
+    packed_counter_update(table->counters, index, up);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "events.h"
+
+static const char* event_names[EVENT_COUNT] = {
+    "BTB Lookups:",
+    "BTB Hits:",
+    "BTB Misses:",
+    "BTB Cold Misses:",
+    "BTB Evictions:",
+    "PHT Aliased:",
+    "PHT Destructive:",
+    "Chose Local:",
+    "Local Chosen Right:",
+    "Chose Global:",
+    "Global Chosen Right:",
+    "Local Right:",
+    "Global Right:",
+};
+
+const char* event_name(PredictorEvent event) {
+    return event_names[event];
+}
+
+#ifdef PREDICTOR_EVENTS
+
+int alias_tracker_init(AliasTracker* tracker, size_t size) {
+    tracker->owners = (uint64_t*)malloc(size * sizeof(uint64_t));
+    if (!tracker->owners) {
+        perror("Failed to allocate memory for alias tracking");
+        return 1;
+    }
+    memset(tracker->owners, 0xFF, size * sizeof(uint64_t)); // No branch has trained any counter yet
+    return 0;
+}
+
+void alias_tracker_free(AliasTracker* tracker) {
+    free(tracker->owners);
+    tracker->owners = NULL;
+}
+
+#endif
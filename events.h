@@ -0,0 +1,78 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Per-run event counters that explain where a predictor's mispredictions come from. Counting
+// only happens in builds with -DPREDICTOR_EVENTS; otherwise COUNT_EVENT and the alias tracking
+// expand to nothing, the tracker allocates nothing and no event rows are printed. Event builds
+// also run every predictor through its generic predict/update path, since the specialised
+// kernels do not count.
+
+typedef enum {
+    EVENT_BTB_LOOKUPS = 0,
+    EVENT_BTB_HITS,
+    EVENT_BTB_MISSES,
+    EVENT_BTB_COLD_MISSES,      // Misses installed in an empty way
+    EVENT_BTB_EVICTIONS,        // Misses that evicted a valid entry
+    EVENT_PHT_ALIASED,          // Shared counter updates whose counter was last trained by another branch
+    EVENT_PHT_DESTRUCTIVE,      // ... of which the counter mispredicted this branch
+    EVENT_CHOSE_LOCAL,          // Tournament chooser selections and how often each choice was right
+    EVENT_CHOSE_LOCAL_CORRECT,
+    EVENT_CHOSE_GLOBAL,
+    EVENT_CHOSE_GLOBAL_CORRECT,
+    EVENT_LOCAL_CORRECT,        // Tournament components right, whichever one was chosen
+    EVENT_GLOBAL_CORRECT,
+    EVENT_COUNT
+} PredictorEvent;
+
+typedef struct {
+    uint64_t counts[EVENT_COUNT];
+} EventCounters;
+
+// Row label of each event in the results
+const char* event_name(PredictorEvent event);
+
+// Remembers the last branch to train every counter of a shared table, to detect aliasing
+typedef struct {
+    uint64_t* owners;
+} AliasTracker;
+
+#ifdef PREDICTOR_EVENTS
+
+#define COUNT_EVENT(counters, event) ((counters)->counts[event]++)
+
+int alias_tracker_init(AliasTracker* tracker, size_t size);
+void alias_tracker_free(AliasTracker* tracker);
+
+// Records that address trained counter index; mispredicted tells whether that counter was wrong
+static inline void alias_tracker_update(AliasTracker* tracker, EventCounters* counters, size_t index, uint64_t address, bool mispredicted) {
+    uint64_t owner = tracker->owners[index];
+    if (owner != address && owner != UINT64_MAX) {
+        counters->counts[EVENT_PHT_ALIASED]++;
+        counters->counts[EVENT_PHT_DESTRUCTIVE] += mispredicted;
+    }
+    tracker->owners[index] = address;
+}
+
+#else
+
+#define COUNT_EVENT(counters, event) ((void)0)
+
+static inline int alias_tracker_init(AliasTracker* tracker, size_t size) {
+    (void)size;
+    tracker->owners = NULL;
+    return 0;
+}
+
+static inline void alias_tracker_free(AliasTracker* tracker) {
+    (void)tracker;
+}
+
+#define alias_tracker_update(tracker, counters, index, address, mispredicted) ((void)0)
+
+#endif
+
+#endif
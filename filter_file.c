@@ -2,56 +2,124 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "branch_trace.h"
+#include "branch_classifier.h"
+#include "filter_file.h"
+#include "trace_reader.h"
 
-#define MAX_LINE_LENGTH 256
+static bool determine_taken(BranchKind kind, uint64_t branch_address, int instruction_bytes, uint64_t next_address) {
+    // Jumps always transfer control; a conditional branch is not taken when execution falls through
+    // to the next instruction, 2 bytes on for c.beqz/c.bnez and 4 for the others
+    return kind != BRANCH_CONDITIONAL || next_address != branch_address + instruction_bytes;
+}
+
+// Filter state carried from one trace line to the next
+typedef struct {
+    uint64_t branch_address;
+    BranchKind pending;         // Branch waiting for the address of the instruction after it
+    int instruction_bytes;
+} LineFilter;
 
-// Function to check if a line contains a branch command
-int isBranchCommand(const char* line) {
-    return (strstr(line, "beq") != NULL || strstr(line, "beqz") != NULL || strstr(line, "bne") != NULL 
-            || strstr(line, "blt") != NULL || strstr(line, "bge") != NULL || strstr(line, "bgtz") != NULL 
-            || strstr(line, "blez") != NULL || strstr(line, "bltz") != NULL || strstr(line, "bgez") != NULL 
-            || strstr(line, "bltu") != NULL || strstr(line, "bgeu") != NULL);
+static void line_filter_init(LineFilter* filter) {
+    filter->branch_address = 0;
+    filter->pending = BRANCH_NONE;
+    filter->instruction_bytes = 4;
 }
 
-void filterBranchCommands(const char* inputFileName, const char* outputFileName) {
-    FILE* inputFile = fopen(inputFileName, "r");
-    FILE* outputFile = fopen(outputFileName, "w");
-    char line[MAX_LINE_LENGTH];
-    char nextLine[MAX_LINE_LENGTH];
-    int writeNextLine = 0;
+static int resolve_pending(LineFilter* filter, uint64_t address, BranchSink* sink) {
+    if (filter->pending == BRANCH_NONE) {
+        return 0;
+    }
+    BranchRecord record;
+    record.address = filter->branch_address;
+    record.target = address;
+    record.taken = determine_taken(filter->pending, filter->branch_address, filter->instruction_bytes, address);
+    record.compressed = filter->instruction_bytes == 2;
+    record.kind = filter->pending;
+    filter->pending = BRANCH_NONE;
+    return sink->write(sink->context, &record);
+}
 
-    if (inputFile == NULL) {
-        perror("Error opening input file");
-        return;
+// Lines without an address (register changes, simulator messages) leave a branch pending
+static int filter_line(LineFilter* filter, const char* line, size_t length, BranchSink* sink) {
+    uint64_t address;
+    if (!parse_trace_address(line, length, &address)) {
+        return 0;
     }
+    int result = resolve_pending(filter, address, sink);
+    filter->pending = classify_trace_line(line, length, &filter->instruction_bytes);
+    filter->branch_address = address;
+    return result;
+}
 
-    if (outputFile == NULL) {
-        perror("Error opening output file");
-        fclose(inputFile);
-        return;
+// Resolves every branch and jump against the instruction that follows it and hands the record to the sink
+int filterBranchRecords(const char* inputFileName, BranchSink* sink) {
+    TraceReader reader;
+    if (trace_reader_open(&reader, inputFileName)) {
+        return 1;
     }
 
-    while (fgets(line, sizeof(line), inputFile)) {
-        if (writeNextLine) {
-            fputs(line, outputFile);
-            writeNextLine = 0;
-        }
-        if (isBranchCommand(line)) {
-            fputs(line, outputFile);
-            writeNextLine = 1;
-        }
+    const char* line;
+    size_t length;
+    LineFilter filter;
+    line_filter_init(&filter);
+    int result = 0;
+    while (result == 0 && trace_reader_next_line(&reader, &line, &length)) {
+        result = filter_line(&filter, line, length, sink);
     }
 
-    fclose(inputFile);
-    fclose(outputFile);
+    if (trace_reader_close(&reader)) result = 1;
+    return result;
 }
 
-int FilterFile(const char* inputFile, const char* outputFile) {
-   
-    filterBranchCommands(inputFile, outputFile);
+static const char* line_end(const char* line, const char* end) {
+    const char* newline = (const char*)memchr(line, '\n', end - line);
+    return newline ? newline : end;
+}
 
-    printf("Filtered branch commands have been written to %s\n", outputFile);
+int filterBranchRange(const char* begin, const char* end, const char* trace_end, BranchSink* sink) {
+    LineFilter filter;
+    line_filter_init(&filter);
+    int result = 0;
+    const char* line = begin;
+    while (result == 0 && line < end) {
+        const char* stop = line_end(line, trace_end);
+        result = filter_line(&filter, line, stop - line, sink);
+        line = stop + 1;
+    }
 
-    return 0;
+    // The last branch of the range is resolved by the first address line of the next one
+    uint64_t address;
+    while (result == 0 && filter.pending != BRANCH_NONE && line < trace_end) {
+        const char* stop = line_end(line, trace_end);
+        if (parse_trace_address(line, stop - line, &address)) {
+            result = resolve_pending(&filter, address, sink);
+        }
+        line = stop + 1;
+    }
+    return result;
+}
+
+static int writer_sink_write(void* context, const BranchRecord* record) {
+    return branch_trace_write((BranchTraceWriter*)context, record);
 }
 
+// Writes one binary record per branch to outputFileName
+int filterBranchCommands(const char* inputFileName, const char* outputFileName) {
+    BranchTraceWriter* writer = (BranchTraceWriter*)malloc(sizeof(BranchTraceWriter));
+    if (writer == NULL || branch_trace_open_writer(writer, outputFileName, inputFileName)) {
+        free(writer);
+        return 1;
+    }
+
+    BranchSink sink;
+    sink.context = writer;
+    sink.write = writer_sink_write;
+    int result = filterBranchRecords(inputFileName, &sink);
+
+    if (branch_trace_close_writer(writer)) result = 1;
+    free(writer);
+    return result;
+}
@@ -0,0 +1,17 @@
+#ifndef FILTER_FILE_H
+#define FILTER_FILE_H
+
+#include "branch_trace.h"
+
+// Filters a riscvOVPsim trace down to a binary branch trace (see branch_trace.h); returns non-zero on failure
+int filterBranchCommands(const char* inputFileName, const char* outputFileName);
+
+// Filters a riscvOVPsim trace and streams the branch records to a sink instead of a file
+int filterBranchRecords(const char* inputFileName, BranchSink* sink);
+
+// Filters the lines of a plain trace held in memory that start in [begin, end), so one trace can be
+// split across threads. begin must start a line; a branch left pending at end is resolved against
+// the first address line before trace_end, as the serial filter would.
+int filterBranchRange(const char* begin, const char* end, const char* trace_end, BranchSink* sink);
+
+#endif
@@ -5,103 +5,146 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
-#include <math.h> 
+#include <math.h>
+#include "counter_table.h"
+#include "events.h"
+#include "history.h"
+#include "kernel_template.h"
+#include "predictor.h"
+
+typedef struct {
+    GlobalHistoryRegister global_bhr;  // Global Branch History Register (BHR), folded when longer than the table index
+    CounterTable shared_counters;       // Packed 2-bit counters indexed by the global BHR
+    int ghr_bits;
+    AliasTracker aliasing;              // Last branch to train each counter, event builds only
+    EventCounters events;
+} GlobalPredictor;
+
+static bool predict_branch(GlobalPredictor* predictor) {
+    return counter_table_predict(&predictor->shared_counters, ghr_index(&predictor->global_bhr));
+}
 
-uint8_t global_bhr = 0; // Global Branch History Register (BHR)
-static uint8_t* shared_counters = NULL; // Dynamic array of 2-bit counters
+static void update_predictor(GlobalPredictor* predictor, uint64_t branch_address, bool taken) {
+    uint32_t index = ghr_index(&predictor->global_bhr);
+    alias_tracker_update(&predictor->aliasing, &predictor->events, index, branch_address,
+        counter_table_predict(&predictor->shared_counters, index) != taken);
 
-static void initialize_predictor(int counter_size) {
-    // Allocate and initialize the shared counters to 'weakly not taken' (01)
-    shared_counters = (uint8_t*)malloc(counter_size * sizeof(uint8_t));
-    if (!shared_counters) {
-        perror("Failed to allocate memory for shared counters");
-        exit(EXIT_FAILURE);
-    }
-    memset(shared_counters, 1, counter_size * sizeof(uint8_t));
+    // Update the counter based on the actual branch outcome
+    counter_table_update(&predictor->shared_counters, index, taken);
+
+    // Update the global BHR (shift in the new outcome)
+    ghr_push(&predictor->global_bhr, taken);
 }
 
-static bool predict_branch() {
-    uint8_t counter = shared_counters[global_bhr];
-    return (counter >> 1) & 0x1; // MSB of the 2-bit counter
+static bool global_predict(void* state, uint64_t branch_address) {
+    return predict_branch((GlobalPredictor*)state);
 }
 
-static void update_predictor(bool taken, int bhr_mask) {
-    // Update the counter based on the actual branch outcome
-    if (taken) {
-        if (shared_counters[global_bhr] < 3) shared_counters[global_bhr]++;
-    }
-    else {
-        if (shared_counters[global_bhr] > 0) shared_counters[global_bhr]--;
-    }
-    // Update the global BHR (shift left, add new outcome)
-    global_bhr = ((global_bhr << 1) | (taken ? 1 : 0)) & bhr_mask; // Keep it ghr_bits size
+static void global_update(void* state, uint64_t branch_address, bool taken) {
+    update_predictor((GlobalPredictor*)state, branch_address, taken);
+}
+
+static void global_stats(const void* state, PredictorStats* stats) {
+    const GlobalPredictor* predictor = (const GlobalPredictor*)state;
+    stats->storage_bits = predictor->ghr_bits + 2 * (uint64_t)predictor->shared_counters.size;
+    stats->memory_bytes = counter_table_bytes(&predictor->shared_counters);
+    stats->events = predictor->events;
 }
 
-static uint64_t parse_address(const char* line) {
-    uint64_t address;
-    sscanf(line, "Info 'riscvOVPsim/cpu', 0x%lx", &address);
-    return address;
+static void global_destroy(void* state) {
+    GlobalPredictor* predictor = (GlobalPredictor*)state;
+    counter_table_free(&predictor->shared_counters);
+    ghr_free(&predictor->global_bhr);
+    alias_tracker_free(&predictor->aliasing);
+    free(predictor);
 }
 
-static bool determine_taken(uint64_t branch_address, uint64_t next_address) {
-    // If the next address is the branch address + 4, branch is not taken
-    return !(next_address == branch_address + 4);
+static int global_save(const void* state, FILE* file) {
+    const GlobalPredictor* predictor = (const GlobalPredictor*)state;
+    return ghr_save(&predictor->global_bhr, file) || counter_table_save(&predictor->shared_counters, file);
 }
 
-int Global(const char* inputFile, int ghr_bits) {
-    
-    int counter_size = 1 << ghr_bits;
-    int bhr_mask = (1 << ghr_bits) - 1;
+static int global_load(void* state, FILE* file) {
+    GlobalPredictor* predictor = (GlobalPredictor*)state;
+    return ghr_load(&predictor->global_bhr, file) || counter_table_load(&predictor->shared_counters, file);
+}
 
-    initialize_predictor(counter_size);
+static int global_init(void** predictor_state, const PredictorConfig* config) {
+    int ghr_bits = config->ghr_bits;
 
-    FILE* file = fopen(inputFile, "r");
-    if (!file) {
-        perror("Failed to open file");
-        free(shared_counters);
+    GlobalPredictor* state = (GlobalPredictor*)calloc(1, sizeof(GlobalPredictor));
+    if (!state) {
+        perror("Failed to allocate memory for global predictor");
         return 1;
     }
 
-    int total_branches = 0;
-    int mispredictions = 0;
-
-    char line[256];
-    uint64_t branch_address, next_address;
-    bool is_branch = true;
-
-    while (fgets(line, sizeof(line), file)) {
-        if (is_branch) {
-            // This line is the branch instruction
-            branch_address = parse_address(line);
-        }
-        else {
-            // This line is the instruction right after the branch
-            next_address = parse_address(line);
+    // A table wider than the history would leave counters unused
+    int index_bits = pht_index_bits(config, ghr_bits);
+    if (index_bits > ghr_bits) index_bits = ghr_bits;
+    state->ghr_bits = ghr_bits;
+    if (ghr_init(&state->global_bhr, ghr_bits, index_bits)) {
+        free(state);
+        return 1;
+    }
 
-            bool taken = determine_taken(branch_address, next_address);
-            bool prediction = predict_branch();
+    // Counters start 'weakly not taken' (01)
+    if (counter_table_init(&state->shared_counters, (size_t)1 << index_bits)) {
+        ghr_free(&state->global_bhr);
+        free(state);
+        return 1;
+    }
+    if (alias_tracker_init(&state->aliasing, (size_t)1 << index_bits)) {
+        global_destroy(state);
+        return 1;
+    }
 
-            if (prediction != taken) {
-                mispredictions++; // Increment mispredictions if prediction was wrong
-            }
-            update_predictor(taken, bhr_mask);
+    *predictor_state = state;
+    return 0;
+}
 
-            total_branches++; // Increment total branches
-        }
+// Batch loop for an unfolded history of BITS bits, which is then the counter index itself.
+// The history lives in a register for the whole batch and is written back at the end.
+#define DEFINE_GLOBAL_KERNEL(BITS) \
+static uint64_t global_kernel_##BITS(void* state, const BranchRecord* records, size_t count) { \
+    GlobalPredictor* predictor = (GlobalPredictor*)state; \
+    uint8_t* counters = predictor->shared_counters.counters; \
+    uint32_t history = ghr_index(&predictor->global_bhr); \
+    uint64_t mispredictions = 0; \
+    for (size_t i = 0; i < count; i++) { \
+        bool taken = records[i].taken; \
+        mispredictions += packed_counter_predict(counters, history) != taken; \
+        packed_counter_update(counters, history, taken); \
+        history = ((history << 1) | taken) & ((1u << (BITS)) - 1); \
+    } \
+    ghr_push_bits(&predictor->global_bhr, history, BITS); \
+    return mispredictions; \
+}
 
-        // Toggle between branch and the instruction after
-        is_branch = !is_branch;
-    }
+#define GLOBAL_KERNELS(X) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+#define GLOBAL_KERNEL_ENTRY(BITS) { { BITS, BITS, 0 }, global_kernel_##BITS },
 
-    double misprediction_rate = (double)mispredictions / total_branches;
+GLOBAL_KERNELS(DEFINE_GLOBAL_KERNEL)
 
-    printf("\n%s for %s:\n", __func__, inputFile);
-    printf("Total Branches: %d\n", total_branches);
-    printf("Mispredictions: %d\n", mispredictions);
-    printf("Misprediction Rate: %.4f\n", misprediction_rate*100);
+static const KernelEntry global_kernels[] = { GLOBAL_KERNELS(GLOBAL_KERNEL_ENTRY) };
 
-    fclose(file);
-    free(shared_counters);
-    return 0;
+static PredictorKernel global_select_kernel(const void* state) {
+    const GlobalPredictor* predictor = (const GlobalPredictor*)state;
+    return find_kernel(global_kernels, KERNEL_COUNT(global_kernels),
+        predictor->ghr_bits, predictor->global_bhr.index.width, 0);
 }
 
+const PredictorType global_predictor = {
+    "Global",
+    global_init,
+    global_predict,
+    global_update,
+    global_stats,
+    global_destroy,
+    global_save,
+    global_load,
+    global_select_kernel,
+    NULL,
+    NULL,
+    NULL,
+};
+
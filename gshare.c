@@ -0,0 +1,141 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "counter_table.h"
+#include "events.h"
+#include "history.h"
+#include "kernel_template.h"
+#include "predictor.h"
+
+// Gshare: the global history is XORed with the branch address, so branches that share a history
+// pattern no longer fight over the same counter. The table has pht_bits index bits (see
+// pht_index_bits), histories longer than that are folded.
+typedef struct {
+    GlobalHistoryRegister global_history;   // Last ghr_bits outcomes, folded into the index width
+    CounterTable counters;      // 2^index_bits packed 2-bit counters
+    uint64_t index_mask;
+    int ghr_bits;
+    uint64_t index;             // Counter used for the branch being predicted
+    AliasTracker aliasing;      // Last branch to train each counter, event builds only
+    EventCounters events;
+} GsharePredictor;
+
+static bool gshare_predict(void* state, uint64_t branch_address) {
+    GsharePredictor* predictor = (GsharePredictor*)state;
+
+    // Instructions are at least 2-byte aligned, so bit 0 of the address carries no information
+    predictor->index = ((branch_address >> 1) ^ ghr_index(&predictor->global_history)) & predictor->index_mask;
+    return counter_table_predict(&predictor->counters, predictor->index);
+}
+
+static void gshare_update(void* state, uint64_t branch_address, bool taken) {
+    GsharePredictor* predictor = (GsharePredictor*)state;
+
+    alias_tracker_update(&predictor->aliasing, &predictor->events, predictor->index, branch_address,
+        counter_table_predict(&predictor->counters, predictor->index) != taken);
+    counter_table_update(&predictor->counters, predictor->index, taken);
+    ghr_push(&predictor->global_history, taken);
+}
+
+static void gshare_stats(const void* state, PredictorStats* stats) {
+    const GsharePredictor* predictor = (const GsharePredictor*)state;
+    stats->storage_bits = predictor->ghr_bits + 2 * (uint64_t)predictor->counters.size;
+    stats->memory_bytes = counter_table_bytes(&predictor->counters);
+    stats->events = predictor->events;
+}
+
+static void gshare_destroy(void* state) {
+    GsharePredictor* predictor = (GsharePredictor*)state;
+    counter_table_free(&predictor->counters);
+    ghr_free(&predictor->global_history);
+    alias_tracker_free(&predictor->aliasing);
+    free(predictor);
+}
+
+static int gshare_save(const void* state, FILE* file) {
+    const GsharePredictor* predictor = (const GsharePredictor*)state;
+    return ghr_save(&predictor->global_history, file) || counter_table_save(&predictor->counters, file);
+}
+
+static int gshare_load(void* state, FILE* file) {
+    GsharePredictor* predictor = (GsharePredictor*)state;
+    return ghr_load(&predictor->global_history, file) || counter_table_load(&predictor->counters, file);
+}
+
+static int gshare_init(void** predictor_state, const PredictorConfig* config) {
+    int ghr_bits = config->ghr_bits;
+    int index_bits = pht_index_bits(config, ghr_bits);
+
+    GsharePredictor* state = (GsharePredictor*)calloc(1, sizeof(GsharePredictor));
+    if (!state) {
+        perror("Failed to allocate memory for gshare predictor");
+        return 1;
+    }
+
+    state->ghr_bits = ghr_bits;
+    state->index_mask = (1ULL << index_bits) - 1;
+    if (ghr_init(&state->global_history, ghr_bits, index_bits)) {
+        free(state);
+        return 1;
+    }
+    if (counter_table_init(&state->counters, (size_t)1 << index_bits)) {
+        ghr_free(&state->global_history);
+        free(state);
+        return 1;
+    }
+    if (alias_tracker_init(&state->aliasing, (size_t)1 << index_bits)) {
+        gshare_destroy(state);
+        return 1;
+    }
+
+    *predictor_state = state;
+    return 0;
+}
+
+// Batch loop for a history exactly as wide as the index, so no folding is needed
+#define DEFINE_GSHARE_KERNEL(BITS) \
+static uint64_t gshare_kernel_##BITS(void* state, const BranchRecord* records, size_t count) { \
+    GsharePredictor* predictor = (GsharePredictor*)state; \
+    uint8_t* counters = predictor->counters.counters; \
+    uint32_t history = ghr_index(&predictor->global_history); \
+    uint64_t mispredictions = 0; \
+    for (size_t i = 0; i < count; i++) { \
+        bool taken = records[i].taken; \
+        size_t index = ((records[i].address >> 1) ^ history) & ((1u << (BITS)) - 1); \
+        mispredictions += packed_counter_predict(counters, index) != taken; \
+        packed_counter_update(counters, index, taken); \
+        history = ((history << 1) | taken) & ((1u << (BITS)) - 1); \
+    } \
+    ghr_push_bits(&predictor->global_history, history, BITS); \
+    return mispredictions; \
+}
+
+#define GSHARE_KERNELS(X) X(4) X(6) X(8) X(10) X(12) X(14) X(16)
+#define GSHARE_KERNEL_ENTRY(BITS) { { BITS, BITS, 0 }, gshare_kernel_##BITS },
+
+GSHARE_KERNELS(DEFINE_GSHARE_KERNEL)
+
+static const KernelEntry gshare_kernels[] = { GSHARE_KERNELS(GSHARE_KERNEL_ENTRY) };
+
+static PredictorKernel gshare_select_kernel(const void* state) {
+    const GsharePredictor* predictor = (const GsharePredictor*)state;
+    return find_kernel(gshare_kernels, KERNEL_COUNT(gshare_kernels),
+        predictor->ghr_bits, predictor->global_history.index.width, 0);
+}
+
+const PredictorType gshare_predictor = {
+    "Gshare",
+    gshare_init,
+    gshare_predict,
+    gshare_update,
+    gshare_stats,
+    gshare_destroy,
+    gshare_save,
+    gshare_load,
+    gshare_select_kernel,
+    NULL,
+    NULL,
+    NULL,
+};
@@ -0,0 +1,118 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "checkpoint.h"
+#include "history.h"
+
+int history_init(GlobalHistory* history, int length) {
+    // One slot more than length so the outcome leaving a length-long window is still there
+    int capacity = 1;
+    while (capacity <= length) capacity <<= 1;
+
+    history->bits = (uint8_t*)calloc(capacity, 1);
+    if (!history->bits) {
+        perror("Failed to allocate memory for branch history");
+        return 1;
+    }
+    history->capacity_mask = capacity - 1;
+    history->head = 0;
+    history->length = length;
+    return 0;
+}
+
+void history_free(GlobalHistory* history) {
+    free(history->bits);
+    history->bits = NULL;
+}
+
+void folded_history_init(FoldedHistory* folded, int length, int width) {
+    folded->value = 0;
+    folded->length = length;
+    folded->width = width;
+    folded->outpoint = width ? length % width : 0;
+}
+
+int ghr_init(GlobalHistoryRegister* ghr, int length, int index_bits) {
+    if (length < 0 || index_bits < 0 || index_bits > MAX_FOLDED_BITS) {
+        fprintf(stderr, "Invalid history of %d bits read as a %d-bit index\n", length, index_bits);
+        return 1;
+    }
+    if (history_init(&ghr->history, length)) {
+        return 1;
+    }
+    folded_history_init(&ghr->index, length, index_bits);
+    return 0;
+}
+
+void ghr_free(GlobalHistoryRegister* ghr) {
+    history_free(&ghr->history);
+}
+
+void ghr_push_bits(GlobalHistoryRegister* ghr, uint64_t recent, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        ghr_push(ghr, (recent >> i) & 1);
+    }
+}
+
+int history_save(const GlobalHistory* history, FILE* file) {
+    size_t size = ((size_t)history->length + 7) / 8;
+    uint8_t* packed = (uint8_t*)calloc(size + 1, 1);
+    if (!packed) {
+        perror("Failed to allocate memory for history checkpoint");
+        return 1;
+    }
+
+    // Only the readable window is kept, oldest outcome first, eight to a byte
+    for (int i = 0; i < history->length; i++) {
+        packed[i / 8] |= (uint8_t)(history_bit(history, history->length - 1 - i) << (i % 8));
+    }
+    int result = checkpoint_write_u64(file, (uint64_t)history->length) || checkpoint_write(file, packed, size);
+    free(packed);
+    return result;
+}
+
+int history_load(GlobalHistory* history, FILE* file) {
+    size_t size = ((size_t)history->length + 7) / 8;
+    uint8_t* packed = (uint8_t*)calloc(size + 1, 1);
+    if (!packed) {
+        perror("Failed to allocate memory for history checkpoint");
+        return 1;
+    }
+
+    int result = checkpoint_expect(file, (uint64_t)history->length, "history length") || checkpoint_read(file, packed, size);
+    if (result == 0) {
+        memset(history->bits, 0, (size_t)history->capacity_mask + 1);
+        history->head = 0;
+        for (int i = 0; i < history->length; i++) {
+            history_push(history, (packed[i / 8] >> (i % 8)) & 1);
+        }
+    }
+    free(packed);
+    return result;
+}
+
+int folded_history_save(const FoldedHistory* folded, FILE* file) {
+    return checkpoint_write_u64(file, (uint64_t)folded->length)
+        || checkpoint_write_u64(file, (uint64_t)folded->width)
+        || checkpoint_write_u64(file, folded->value);
+}
+
+int folded_history_load(FoldedHistory* folded, FILE* file) {
+    uint64_t value;
+    if (checkpoint_expect(file, (uint64_t)folded->length, "folded history length")
+        || checkpoint_expect(file, (uint64_t)folded->width, "folded history width")
+        || checkpoint_read_u64(file, &value)) {
+        return 1;
+    }
+    folded->value = (uint32_t)value;
+    return 0;
+}
+
+int ghr_save(const GlobalHistoryRegister* ghr, FILE* file) {
+    return history_save(&ghr->history, file) || folded_history_save(&ghr->index, file);
+}
+
+int ghr_load(GlobalHistoryRegister* ghr, FILE* file) {
+    return history_load(&ghr->history, file) || folded_history_load(&ghr->index, file);
+}
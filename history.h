@@ -0,0 +1,83 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Global branch history of arbitrary length. Outcomes are kept one per byte in a circular buffer
+// whose capacity is a power of two larger than the longest history anyone reads.
+typedef struct {
+    uint8_t* bits;
+    int capacity_mask;      // capacity - 1
+    int head;               // Slot of the most recent outcome
+    int length;             // Longest history that can be read back
+} GlobalHistory;
+
+// A window of the last length outcomes XOR-folded into width bits. Updating it after every
+// push costs O(1) whatever the length, which is how long histories are turned into table indices.
+typedef struct {
+    uint32_t value;
+    int length;
+    int width;
+    int outpoint;           // Where the outcome leaving the window lands in the folded value
+} FoldedHistory;
+
+#define MAX_FOLDED_BITS 31
+
+// A global history register of any length, read back as an index of index_bits bits. Histories
+// no longer than index_bits are used as is; longer ones are folded down to index_bits.
+typedef struct {
+    GlobalHistory history;
+    FoldedHistory index;
+} GlobalHistoryRegister;
+
+// Allocates an all not-taken history able to return the last length outcomes
+int history_init(GlobalHistory* history, int length);
+void history_free(GlobalHistory* history);
+
+void folded_history_init(FoldedHistory* folded, int length, int width);
+
+int ghr_init(GlobalHistoryRegister* ghr, int length, int index_bits);
+void ghr_free(GlobalHistoryRegister* ghr);
+
+// Pushes the count outcomes in recent (newest in bit 0), e.g. to write back a history a specialised
+// loop kept in a plain integer. With count >= length the register then holds exactly those outcomes.
+void ghr_push_bits(GlobalHistoryRegister* ghr, uint64_t recent, int count);
+
+// Checkpoint helpers; loading fails unless the lengths and widths match the saved ones
+int history_save(const GlobalHistory* history, FILE* file);
+int history_load(GlobalHistory* history, FILE* file);
+int folded_history_save(const FoldedHistory* folded, FILE* file);
+int folded_history_load(FoldedHistory* folded, FILE* file);
+int ghr_save(const GlobalHistoryRegister* ghr, FILE* file);
+int ghr_load(GlobalHistoryRegister* ghr, FILE* file);
+
+// Outcome of the branch age branches ago, 0 being the most recent one
+static inline bool history_bit(const GlobalHistory* history, int age) {
+    return history->bits[(history->head - age) & history->capacity_mask];
+}
+
+static inline void history_push(GlobalHistory* history, bool taken) {
+    history->head = (history->head + 1) & history->capacity_mask;
+    history->bits[history->head] = taken;
+}
+
+// Folds in the outcome just pushed and drops the one that fell out of the window
+static inline void folded_history_update(FoldedHistory* folded, const GlobalHistory* history) {
+    uint32_t value = (folded->value << 1) | history_bit(history, 0);
+    value ^= (uint32_t)history_bit(history, folded->length) << folded->outpoint;
+    value ^= value >> folded->width;
+    folded->value = value & ((1u << folded->width) - 1);
+}
+
+static inline void ghr_push(GlobalHistoryRegister* ghr, bool taken) {
+    history_push(&ghr->history, taken);
+    folded_history_update(&ghr->index, &ghr->history);
+}
+
+static inline uint32_t ghr_index(const GlobalHistoryRegister* ghr) {
+    return ghr->index.value;
+}
+
+#endif
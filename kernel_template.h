@@ -0,0 +1,38 @@
+#ifndef KERNEL_TEMPLATE_H
+#define KERNEL_TEMPLATE_H
+
+#include <stddef.h>
+#include "predictor.h"
+
+// Compile-time specialised simulation loops.
+//
+// A predictor writes its batch loop once as a macro whose sizes are macro parameters, then
+// instantiates it with an X-macro list of common configurations, e.g.
+//
+//   #define GLOBAL_KERNELS(X) X(4) X(6) X(8)
+//   GLOBAL_KERNELS(DEFINE_GLOBAL_KERNEL)
+//   static const KernelEntry global_kernels[] = { GLOBAL_KERNELS(GLOBAL_KERNEL_ENTRY) };
+//
+// Inside each instance the masks, shifts and way counts are constants the compiler folds and
+// unrolls. The predictor's select_kernel looks its runtime configuration up with find_kernel and
+// falls back to the generic predict/update loop when no instance matches.
+
+#define KERNEL_KEY_SIZE 3
+
+typedef struct {
+    int key[KERNEL_KEY_SIZE];   // Configuration the kernel was compiled for, unused slots 0
+    PredictorKernel kernel;
+} KernelEntry;
+
+static inline PredictorKernel find_kernel(const KernelEntry* table, size_t count, int a, int b, int c) {
+    for (size_t i = 0; i < count; i++) {
+        if (table[i].key[0] == a && table[i].key[1] == b && table[i].key[2] == c) {
+            return table[i].kernel;
+        }
+    }
+    return NULL;
+}
+
+#define KERNEL_COUNT(table) (sizeof(table) / sizeof((table)[0]))
+
+#endif
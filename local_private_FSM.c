@@ -5,192 +5,221 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include "btb.h"
+#include "counter_table.h"
+#include "events.h"
+#include "kernel_template.h"
+#include "predictor.h"
 
 typedef struct {
-    uint64_t tag;           // Tag (assuming 64-bit address and variable index bits)
-    uint8_t bhr;            // Branch History Register (BHR)
-    uint8_t* counters;      // Dynamic array of 2-bit counters
-    bool valid;             // Valid bit
-} BTBEntry;
-
-typedef struct {
-    BTBEntry entries[2];    // 2-way set associative (2 entries per set)
-    bool lru_bit;           // LRU bit to track the least recently used entry
-} BTBSet;
-
-static void initialize_btb(BTBSet* btb, int btb_sets, int bhr_size) {
-    for (int i = 0; i < btb_sets; i++) {
-        btb[i].entries[0].valid = false;
-        btb[i].entries[1].valid = false;
-        btb[i].lru_bit = false; // Start with the first entry as LRU
-
-        // Allocate counters dynamically for each entry
-        btb[i].entries[0].counters = (uint8_t*)malloc(bhr_size * sizeof(uint8_t));
-        btb[i].entries[1].counters = (uint8_t*)malloc(bhr_size * sizeof(uint8_t));
-        if (!btb[i].entries[0].counters || !btb[i].entries[1].counters) {
-            perror("Failed to allocate memory for local predictor counters");
-            exit(EXIT_FAILURE);
-        }
-
-        // Initialize counters to 'weakly not taken' (01)
-        memset(btb[i].entries[0].counters, 1, bhr_size * sizeof(uint8_t));
-        memset(btb[i].entries[1].counters, 1, bhr_size * sizeof(uint8_t));
-    }
+    BTB btb;                // Each entry keeps its own BHR and 2^bhr_bits counters
+    int bhr_bits;
+    int bhr_mask;
+    BTBSet* set;            // Lookup of the branch being predicted, reused by the update
+    uint64_t tag;
+    int way;
+    EventCounters events;
+} LocalPrivateFSM;
+
+static bool predict_branch(const uint8_t* counters, uint16_t bhr_value) {
+    return packed_counter_predict(counters, bhr_value);
 }
 
-static uint16_t get_index(uint64_t address, int index_bits) {
-    return (address & ((1ULL << index_bits) - 1));
-}
+static void update_entry(LocalPrivateFSM* predictor, BTBSet* set, int way, bool taken) {
+    uint8_t* counters = btb_counters(&predictor->btb, set, way);
+    uint16_t* bhr = btb_bhr(&predictor->btb, set, way);
+    uint16_t bhr_value = *bhr;
 
-static uint64_t get_tag(uint64_t address, int index_bits) {
-    return (address >> index_bits);
-}
+    // Update the counter based on the actual branch outcome
+    packed_counter_update(counters, bhr_value, taken);
 
-static bool predict_branch(BTBEntry* entry) {
-    uint8_t bhr_value = entry->bhr;
-    uint8_t counter = entry->counters[bhr_value];
-    return (counter >> 1) & 0x1; // MSB of the 2-bit counter
+    // Update BHR (shift left, add new outcome)
+    *bhr = (uint16_t)((bhr_value << 1) | (taken ? 1 : 0)) & predictor->bhr_mask; // Keep it BHR_BITS size
 }
 
-static void update_btb(BTBSet* btb, uint64_t address, bool taken, int index_bits, int btb_sets, int bhr_mask) {
-    uint16_t index = get_index(address, index_bits);
-    uint64_t tag = get_tag(address, index_bits);
-
-    BTBSet* set = &btb[index % btb_sets];
-    BTBEntry* entry = NULL;
+static bool local_private_fsm_predict(void* state, uint64_t branch_address) {
+    LocalPrivateFSM* predictor = (LocalPrivateFSM*)state;
+    predictor->set = btb_set(&predictor->btb, branch_address);
+    predictor->tag = btb_tag(&predictor->btb, branch_address);
+    predictor->way = btb_find(&predictor->btb, predictor->set, predictor->tag);
+    COUNT_EVENT(&predictor->events, EVENT_BTB_LOOKUPS);
 
-    // Search for the entry by comparing tags of both entries in the set
-    if (set->entries[0].valid && set->entries[0].tag == tag) {
-        entry = &set->entries[0]; // Match found in way 0
-    }
-    else if (set->entries[1].valid && set->entries[1].tag == tag) {
-        entry = &set->entries[1]; // Match found in way 1
+    if (predictor->way < 0) {
+        COUNT_EVENT(&predictor->events, EVENT_BTB_MISSES);
+        return false; // A BTB miss is predicted not taken
     }
+    COUNT_EVENT(&predictor->events, EVENT_BTB_HITS);
+    return predict_branch(btb_counters(&predictor->btb, predictor->set, predictor->way),
+        *btb_bhr(&predictor->btb, predictor->set, predictor->way));
+}
+
+static void local_private_fsm_update(void* state, uint64_t branch_address, bool taken) {
+    LocalPrivateFSM* predictor = (LocalPrivateFSM*)state;
 
-    if (entry) {
-        // Update the counter based on the actual branch outcome
-        uint8_t bhr_value = entry->bhr;
-        if (taken) {
-            if (entry->counters[bhr_value] < 3) entry->counters[bhr_value]++;
-        }
-        else {
-            if (entry->counters[bhr_value] > 0) entry->counters[bhr_value]--;
-        }
-        // Update BHR (shift left, add new outcome)
-        entry->bhr = ((entry->bhr << 1) | (taken ? 1 : 0)) & bhr_mask; // Keep it BHR_BITS size
+    if (predictor->way >= 0) {
+        update_entry(predictor, predictor->set, predictor->way, taken);
+        btb_touch(&predictor->btb, predictor->set, predictor->way);
     }
     else {
-        // No matching entry found, use the LRU bit to determine which entry to replace
-        int entry_index = set->lru_bit ? 1 : 0; // Select the LRU entry for replacement
-        entry = &set->entries[entry_index];
-
-        // Initialize the new entry with the branch data
-        entry->tag = tag;
-        entry->valid = true;
-        entry->bhr = 0; // Start with no history
-        memset(entry->counters, 1, 8 * sizeof(uint8_t)); // Initialize counters to 'weakly not taken' (01)
+        // The replacement policy's victim is replaced by this branch
+        COUNT_EVENT(&predictor->events, btb_set_full(&predictor->btb, predictor->set) ? EVENT_BTB_EVICTIONS : EVENT_BTB_COLD_MISSES);
+        btb_replace(&predictor->btb, predictor->set, predictor->tag);
     }
+}
 
-    // Update the LRU bit to reflect the most recently used entry
-    set->lru_bit = (entry == &set->entries[0]) ? 1 : 0;
+static void local_private_fsm_stats(const void* state, PredictorStats* stats) {
+    const LocalPrivateFSM* predictor = (const LocalPrivateFSM*)state;
+    stats->storage_bits = btb_storage_bits(&predictor->btb, predictor->bhr_bits);
+    stats->memory_bytes = btb_memory_bytes(&predictor->btb);
+    stats->events = predictor->events;
 }
 
-static uint64_t parse_address(const char* line) {
-    uint64_t address;
-    sscanf(line, "Info 'riscvOVPsim/cpu', 0x%lx", &address);
-    return address;
+static void local_private_fsm_destroy(void* state) {
+    LocalPrivateFSM* predictor = (LocalPrivateFSM*)state;
+    btb_free(&predictor->btb);
+    free(predictor);
 }
 
-static bool determine_taken(uint64_t branch_address, uint64_t next_address) {
-    // If the next address is the branch address + 4, branch is not taken
-    return !(next_address == branch_address + 4);
+static int local_private_fsm_save(const void* state, FILE* file) {
+    const LocalPrivateFSM* predictor = (const LocalPrivateFSM*)state;
+    return btb_save(&predictor->btb, file);
 }
 
-int Local_private_FSM(const char* inputFile, int bhr_bits, int btb_entries) {
-    
-    int index_bits = (int)(log2(btb_entries / 2));
-    int btb_sets = btb_entries / 2;
-    int bhr_size = 1 << bhr_bits;
-    int bhr_mask = (1 << bhr_bits) - 1;
+static int local_private_fsm_load(void* state, FILE* file) {
+    LocalPrivateFSM* predictor = (LocalPrivateFSM*)state;
+    return btb_load(&predictor->btb, file);
+}
+
+static int local_private_fsm_init(void** predictor_state, const PredictorConfig* config) {
+    int bhr_bits = config->bhr_bits;
 
-    BTBSet* btb = (BTBSet*)malloc(btb_sets * sizeof(BTBSet));
-    if (!btb) {
-        perror("Failed to allocate memory for BTB sets");
+    if (btb_check_bhr_bits(bhr_bits)) {
         return 1;
     }
-    initialize_btb(btb, btb_sets, bhr_size);
 
-    FILE* file = fopen(inputFile, "r");
-    if (!file) {
-        perror("Failed to open file");
-        free(btb);
+    LocalPrivateFSM* state = (LocalPrivateFSM*)calloc(1, sizeof(LocalPrivateFSM));
+    if (!state) {
+        perror("Failed to allocate memory for local private predictor");
         return 1;
     }
 
-    int total_branches = 0;
-    int mispredictions = 0;
-
-    char line[256];
-    uint64_t branch_address, next_address;
-    bool is_branch = true;
-
-    while (fgets(line, sizeof(line), file)) {
-        if (is_branch) {
-            // This line is the branch instruction
-            branch_address = parse_address(line);
-        }
-        else {
-            // This line is the instruction right after the branch
-            next_address = parse_address(line);
-
-            // Determine if the branch was taken or not
-            bool taken = determine_taken(branch_address, next_address);
-
-            // Predict and update BTB
-            uint16_t index = get_index(branch_address, index_bits);
-            uint64_t tag = get_tag(branch_address, index_bits);
-            BTBSet* set = &btb[index % btb_sets];
-            BTBEntry* entry = NULL;
-
-            // Check both entries in the set
-            if (set->entries[0].valid && set->entries[0].tag == tag) {
-                entry = &set->entries[0];
-            }
-            else if (set->entries[1].valid && set->entries[1].tag == tag) {
-                entry = &set->entries[1];
-            }
-
-            if (entry) {
-                bool prediction = predict_branch(entry);
-
-                if (prediction != taken) {
-                    mispredictions++; // Increment mispredictions if prediction was wrong
-                }
-                update_btb(btb, branch_address, taken, index_bits, btb_sets, bhr_mask);
-            }
-            else {
-                update_btb(btb, branch_address, taken, index_bits, btb_sets, bhr_mask);
-
-                if (taken) {
-                    mispredictions++; // Increment mispredictions if the initial prediction was wrong
-                }
-            }
-
-            total_branches++; // Increment total branches
-        }
-
-        // Toggle between branch and the instruction after
-        is_branch = !is_branch;
+    int bhr_size = 1 << bhr_bits;
+    state->bhr_bits = bhr_bits;
+    state->bhr_mask = (1 << bhr_bits) - 1;
+    if (btb_init(&state->btb, config->btb_entries, config->btb_ways, config->btb_replacement, bhr_size, config->targets)) {
+        free(state);
+        return 1;
     }
 
-    double misprediction_rate = (double)mispredictions / total_branches;
+    *predictor_state = state;
+    return 0;
+}
 
-    printf("\n%s for %s:\n", __func__, inputFile);
-    printf("Total Branches: %d\n", total_branches);
-    printf("Mispredictions: %d\n", mispredictions);
-    printf("Misprediction Rate: %.4f\n", misprediction_rate*100);
+// Batch loop for an LRU BTB of 2^INDEX_BITS sets of WAYS ways with BHR_BITS-bit histories. The set
+// index, tag split, history mask and way loop are constants; the hit/replace logic mirrors
+// btb_find, btb_touch and btb_replace for LRU and must stay in step with them.
+#define DEFINE_LOCAL_PRIVATE_KERNEL(BHR_BITS, INDEX_BITS, WAYS) \
+static uint64_t local_private_kernel_##BHR_BITS##_##INDEX_BITS##_##WAYS(void* state, const BranchRecord* records, size_t count) { \
+    LocalPrivateFSM* predictor = (LocalPrivateFSM*)state; \
+    BTB* btb = &predictor->btb; \
+    uint8_t* sets = btb->sets; \
+    const size_t stride = btb->set_stride; \
+    const size_t replacement_offset = btb->replacement_offset; \
+    const size_t bhr_offset = btb->bhr_offset; \
+    const size_t counters_offset = btb->counters_offset; \
+    const size_t entry_bytes = COUNTER_BYTES(1 << (BHR_BITS)); \
+    uint64_t clock = btb->clock; \
+    uint64_t mispredictions = 0; \
+    for (size_t i = 0; i < count; i++) { \
+        uint64_t address = records[i].address; \
+        bool taken = records[i].taken; \
+        uint8_t* set = sets + (address & ((1ULL << (INDEX_BITS)) - 1)) * stride; \
+        uint64_t tag = address >> (INDEX_BITS); \
+        uint64_t* tags = (uint64_t*)set; \
+        uint64_t* stamps = (uint64_t*)(set + replacement_offset); \
+        uint16_t* bhrs = (uint16_t*)(set + bhr_offset); \
+        int way = -1; \
+        for (int w = 0; w < (WAYS); w++) { \
+            if (tags[w] == tag) way = w; \
+        } \
+        if (way >= 0) { \
+            uint8_t* counters = set + counters_offset + (size_t)way * entry_bytes; \
+            uint16_t bhr = bhrs[way]; \
+            mispredictions += packed_counter_predict(counters, bhr) != taken; \
+            packed_counter_update(counters, bhr, taken); \
+            bhrs[way] = (uint16_t)(((bhr << 1) | taken) & ((1 << (BHR_BITS)) - 1)); \
+            stamps[way] = ++clock; \
+        } \
+        else { \
+            mispredictions += taken; /* A BTB miss is predicted not taken */ \
+            /* First invalid way, otherwise the least recently used one */ \
+            int victim = 0; \
+            for (int w = (WAYS) - 1; w >= 0; w--) { \
+                if (tags[w] == BTB_INVALID_TAG) victim = w; \
+            } \
+            if (tags[victim] != BTB_INVALID_TAG) { \
+                for (int w = 1; w < (WAYS); w++) { \
+                    if (stamps[w] < stamps[victim]) victim = w; \
+                } \
+            } \
+            tags[victim] = tag; \
+            bhrs[victim] = 0; \
+            packed_counters_reset(set + counters_offset + (size_t)victim * entry_bytes, 1 << (BHR_BITS)); \
+            stamps[victim] = ++clock; \
+        } \
+    } \
+    btb->clock = clock; \
+    return mispredictions; \
+}
 
-    fclose(file);
-    free(btb);
-    return 0;
+// (bhr_bits, set index bits, ways): 2048 and 4096 entries in 2 ways, 1024 to 4096 in 4 ways
+#define LOCAL_PRIVATE_KERNELS(X) \
+    X(2, 9, 2) X(2, 10, 2) X(2, 11, 2) \
+    X(3, 9, 2) X(3, 10, 2) X(3, 11, 2) \
+    X(4, 9, 2) X(4, 10, 2) X(4, 11, 2) \
+    X(6, 9, 2) X(6, 10, 2) X(6, 11, 2) \
+    X(8, 9, 2) X(8, 10, 2) X(8, 11, 2) \
+    X(3, 8, 4) X(3, 9, 4) X(3, 10, 4) \
+    X(4, 8, 4) X(4, 9, 4) X(4, 10, 4)
+#define LOCAL_PRIVATE_KERNEL_ENTRY(BHR_BITS, INDEX_BITS, WAYS) \
+    { { BHR_BITS, INDEX_BITS, WAYS }, local_private_kernel_##BHR_BITS##_##INDEX_BITS##_##WAYS },
+
+LOCAL_PRIVATE_KERNELS(DEFINE_LOCAL_PRIVATE_KERNEL)
+
+static const KernelEntry local_private_kernels[] = { LOCAL_PRIVATE_KERNELS(LOCAL_PRIVATE_KERNEL_ENTRY) };
+
+static PredictorKernel local_private_fsm_select_kernel(const void* state) {
+    const LocalPrivateFSM* predictor = (const LocalPrivateFSM*)state;
+    if (predictor->btb.replacement != BTB_REPLACE_LRU) {
+        return NULL;
+    }
+    return find_kernel(local_private_kernels, KERNEL_COUNT(local_private_kernels),
+        predictor->bhr_bits, predictor->btb.index_bits, predictor->btb.ways);
 }
+
+static bool local_private_fsm_btb_missed(const void* state) {
+    return ((const LocalPrivateFSM*)state)->way < 0;
+}
+
+static BTB* local_private_fsm_target_btb(void* state) {
+    return &((LocalPrivateFSM*)state)->btb;
+}
+
+static void local_private_fsm_prefetch(const void* state, uint64_t branch_address) {
+    btb_prefetch(&((const LocalPrivateFSM*)state)->btb, branch_address);
+}
+
+const PredictorType local_private_fsm_predictor = {
+    "Local_private_FSM",
+    local_private_fsm_init,
+    local_private_fsm_predict,
+    local_private_fsm_update,
+    local_private_fsm_stats,
+    local_private_fsm_destroy,
+    local_private_fsm_save,
+    local_private_fsm_load,
+    local_private_fsm_select_kernel,
+    local_private_fsm_btb_missed,
+    local_private_fsm_target_btb,
+    local_private_fsm_prefetch,
+};
@@ -5,196 +5,155 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include "btb.h"
+#include "counter_table.h"
+#include "events.h"
+#include "predictor.h"
 
 typedef struct {
-    uint64_t tag;           // Tag (assuming 64-bit address and variable index bits)
-    uint8_t bhr;            // Branch History Register (BHR)
-    bool valid;             // Valid bit
-} BTBEntry;
-
-typedef struct {
-    BTBEntry entries[2];    // 2-way set associative (2 entries per set)
-    bool lru_bit;           // LRU bit to track the least recently used entry
-} BTBSet;
+    BTB btb;                    // Entries keep a private BHR but no counters of their own
+    CounterTable shared_counters;   // Packed 2-bit counters indexed by the entry's BHR
+    int bhr_bits;
+    int bhr_mask;
+    BTBSet* set;                // Lookup of the branch being predicted, reused by the update
+    uint64_t tag;
+    int way;
+    AliasTracker aliasing;      // Last branch to train each shared counter, event builds only
+    EventCounters events;
+} LocalSharedFSM;
+
+static bool predict_branch(LocalSharedFSM* predictor, uint16_t bhr_value) {
+    return counter_table_predict(&predictor->shared_counters, bhr_value);
+}
 
-static uint8_t* shared_counters = NULL; // Dynamic array of 2-bit counters
+static void update_entry(LocalSharedFSM* predictor, BTBSet* set, int way, uint64_t branch_address, bool taken) {
+    uint16_t* bhr = btb_bhr(&predictor->btb, set, way);
+    uint16_t bhr_value = *bhr;
 
-static void initialize_btb(BTBSet btb[], int btb_sets, int counter_size) {
-    for (int i = 0; i < btb_sets; i++) {
-        btb[i].entries[0].valid = false;
-        btb[i].entries[1].valid = false;
-        btb[i].lru_bit = false; // Start with the first entry as LRU
-    }
+    alias_tracker_update(&predictor->aliasing, &predictor->events, bhr_value, branch_address,
+        counter_table_predict(&predictor->shared_counters, bhr_value) != taken);
 
-    // Allocate and initialize the shared counters to 'weakly not taken' (01)
-    shared_counters = (uint8_t*)malloc(counter_size * sizeof(uint8_t));
-    if (!shared_counters) {
-        perror("Failed to allocate memory for shared counters");
-        exit(EXIT_FAILURE);
-    }
-    memset(shared_counters, 1, counter_size * sizeof(uint8_t)); // Initialize counters
-}
+    // Update the counter based on the actual branch outcome
+    counter_table_update(&predictor->shared_counters, bhr_value, taken);
 
-static uint16_t get_index(uint64_t address, int index_bits) {
-    return (address & ((1ULL << index_bits) - 1));
+    // Update BHR (shift left, add new outcome)
+    *bhr = (uint16_t)((bhr_value << 1) | (taken ? 1 : 0)) & predictor->bhr_mask; // Keep it BHR_BITS size
 }
 
-static uint64_t get_tag(uint64_t address, int index_bits) {
-    return (address >> index_bits);
-}
+static bool local_shared_fsm_predict(void* state, uint64_t branch_address) {
+    LocalSharedFSM* predictor = (LocalSharedFSM*)state;
+    predictor->set = btb_set(&predictor->btb, branch_address);
+    predictor->tag = btb_tag(&predictor->btb, branch_address);
+    predictor->way = btb_find(&predictor->btb, predictor->set, predictor->tag);
+    COUNT_EVENT(&predictor->events, EVENT_BTB_LOOKUPS);
 
-static bool predict_branch(BTBEntry* entry) {
-    uint8_t bhr_value = entry->bhr;
-    uint8_t counter = shared_counters[bhr_value];
-    return (counter >> 1) & 0x1; // MSB of the 2-bit counter
+    if (predictor->way < 0) {
+        COUNT_EVENT(&predictor->events, EVENT_BTB_MISSES);
+        return false; // A BTB miss is predicted not taken
+    }
+    COUNT_EVENT(&predictor->events, EVENT_BTB_HITS);
+    return predict_branch(predictor, *btb_bhr(&predictor->btb, predictor->set, predictor->way));
 }
 
-static void update_btb(BTBSet btb[], uint64_t address, bool taken, int index_bits, int btb_sets, int bhr_mask) {
-    uint16_t index = get_index(address, index_bits);
-    uint64_t tag = get_tag(address, index_bits);
+static void local_shared_fsm_update(void* state, uint64_t branch_address, bool taken) {
+    LocalSharedFSM* predictor = (LocalSharedFSM*)state;
 
-    BTBSet* set = &btb[index % btb_sets];
-    BTBEntry* entry = NULL;
-
-    // Search for the entry by comparing tags of both entries in the set
-    if (set->entries[0].valid && set->entries[0].tag == tag) {
-        entry = &set->entries[0]; // Match found in way 0
-    }
-    else if (set->entries[1].valid && set->entries[1].tag == tag) {
-        entry = &set->entries[1]; // Match found in way 1
-    }
-
-    if (entry) {
-        // Update the counter based on the actual branch outcome
-        uint8_t bhr_value = entry->bhr;
-        if (taken) {
-            if (shared_counters[bhr_value] < 3) shared_counters[bhr_value]++;
-        }
-        else {
-            if (shared_counters[bhr_value] > 0) shared_counters[bhr_value]--;
-        }
-        // Update BHR (shift left, add new outcome)
-        entry->bhr = ((entry->bhr << 1) | (taken ? 1 : 0)) & bhr_mask; // Keep it BHR_BITS size
+    if (predictor->way >= 0) {
+        update_entry(predictor, predictor->set, predictor->way, branch_address, taken);
+        btb_touch(&predictor->btb, predictor->set, predictor->way);
     }
     else {
-        // No matching entry found, use the LRU bit to determine which entry to replace
-        int entry_index = set->lru_bit ? 1 : 0; // Select the LRU entry for replacement
-        entry = &set->entries[entry_index];
-
-        // Initialize the new entry with the branch data
-        entry->tag = tag;
-        entry->valid = true;
-        entry->bhr = 0; // Start with no history
+        // The new entry starts from the shared counters
+        COUNT_EVENT(&predictor->events, btb_set_full(&predictor->btb, predictor->set) ? EVENT_BTB_EVICTIONS : EVENT_BTB_COLD_MISSES);
+        btb_replace(&predictor->btb, predictor->set, predictor->tag);
     }
+}
 
-    // Update the LRU bit to reflect the most recently used entry
-    set->lru_bit = (entry == &set->entries[0]) ? 1 : 0;
+static void local_shared_fsm_stats(const void* state, PredictorStats* stats) {
+    const LocalSharedFSM* predictor = (const LocalSharedFSM*)state;
+    stats->storage_bits = btb_storage_bits(&predictor->btb, predictor->bhr_bits) + 2 * (uint64_t)predictor->shared_counters.size;
+    stats->memory_bytes = btb_memory_bytes(&predictor->btb) + counter_table_bytes(&predictor->shared_counters);
+    stats->events = predictor->events;
 }
 
-static uint64_t parse_address(const char* line) {
-    uint64_t address;
-    sscanf(line, "Info 'riscvOVPsim/cpu', 0x%lx", &address);
-    return address;
+static void local_shared_fsm_destroy(void* state) {
+    LocalSharedFSM* predictor = (LocalSharedFSM*)state;
+    btb_free(&predictor->btb);
+    counter_table_free(&predictor->shared_counters);
+    alias_tracker_free(&predictor->aliasing);
+    free(predictor);
 }
 
-static bool determine_taken(uint64_t branch_address, uint64_t next_address) {
-    // If the next address is the branch address + 4, branch is not taken
-    return !(next_address == branch_address + 4);
+static int local_shared_fsm_save(const void* state, FILE* file) {
+    const LocalSharedFSM* predictor = (const LocalSharedFSM*)state;
+    return btb_save(&predictor->btb, file) || counter_table_save(&predictor->shared_counters, file);
 }
 
-int Local_shared_FSM(const char* inputFile) {
-    
-    int bhr_bits = 3;
-    int btb_entries = 2048;
+static int local_shared_fsm_load(void* state, FILE* file) {
+    LocalSharedFSM* predictor = (LocalSharedFSM*)state;
+    return btb_load(&predictor->btb, file) || counter_table_load(&predictor->shared_counters, file);
+}
 
-    int index_bits = (int)(log2(btb_entries / 2));
-    int tag_bits = 64 - index_bits; // Assuming 64-bit addresses
-    int btb_sets = btb_entries / 2;
-    int counter_size = 1 << bhr_bits;
-    int bhr_mask = (1 << bhr_bits) - 1;
+static int local_shared_fsm_init(void** predictor_state, const PredictorConfig* config) {
+    int bhr_bits = config->bhr_bits;
+    int btb_entries = config->btb_entries;
 
-    BTBSet* btb = (BTBSet*)malloc(btb_sets * sizeof(BTBSet));
-    if (!btb) {
-        perror("Failed to allocate memory for BTB sets");
+    if (btb_check_bhr_bits(bhr_bits)) {
         return 1;
     }
-    initialize_btb(btb, btb_sets, counter_size);
 
-    FILE* file = fopen(inputFile, "r");
-    if (!file) {
-        perror("Failed to open file");
-        free(btb);
-        free(shared_counters);
+    LocalSharedFSM* state = (LocalSharedFSM*)calloc(1, sizeof(LocalSharedFSM));
+    if (!state) {
+        perror("Failed to allocate memory for local shared predictor");
         return 1;
     }
 
-    int total_branches = 0;
-    int mispredictions = 0;
-
-    char line[256];
-    uint64_t branch_address, next_address;
-    bool is_branch = true;
-
-    while (fgets(line, sizeof(line), file)) {
-        if (is_branch) {
-            // This line is the branch instruction
-            branch_address = parse_address(line);
-        }
-        else {
-            // This line is the instruction right after the branch
-            next_address = parse_address(line);
-
-            bool taken = determine_taken(branch_address, next_address);
-
-            uint16_t index = get_index(branch_address, index_bits);
-            uint64_t tag = get_tag(branch_address, index_bits);
-
-            BTBSet* set = &btb[index % btb_sets];
-            BTBEntry* entry = NULL;
-
-            // Check both entries in the set
-            if (set->entries[0].valid && set->entries[0].tag == tag) {
-                entry = &set->entries[0];
-            }
-            else if (set->entries[1].valid && set->entries[1].tag == tag) {
-                entry = &set->entries[1];
-            }
-
-            // Predict and update BTB
-            if (entry) {
-                bool prediction = predict_branch(entry);
-
-                if (prediction != taken) {
-                    mispredictions++; // Increment mispredictions if prediction was wrong
-                }
-                update_btb(btb, branch_address, taken, index_bits, btb_sets, bhr_mask);
-            }
-            else {
-                // If miss, update the BTB with this new branch
-                update_btb(btb, branch_address, taken, index_bits, btb_sets, bhr_mask);
-                // The first-time prediction will be based on initialized counter values
-
-                if (taken) {
-                    mispredictions++; // Increment mispredictions if the initial prediction was wrong
-                }
-            }
-
-            total_branches++; // Increment total branches
-        }
-
-        // Toggle between branch and the instruction after
-        is_branch = !is_branch;
+    state->bhr_bits = bhr_bits;
+    state->bhr_mask = (1 << bhr_bits) - 1;
+    int counter_size = 1 << bhr_bits;
+
+    if (btb_init(&state->btb, btb_entries, config->btb_ways, config->btb_replacement, 0, config->targets)) {
+        free(state);
+        return 1;
+    }
+    if (counter_table_init(&state->shared_counters, counter_size)) {
+        btb_free(&state->btb);
+        free(state);
+        return 1;
+    }
+    if (alias_tracker_init(&state->aliasing, counter_size)) {
+        local_shared_fsm_destroy(state);
+        return 1;
     }
 
-    double misprediction_rate = (double)mispredictions / total_branches;
+    *predictor_state = state;
+    return 0;
+}
 
-    printf("\n%s for %s:\n", __func__, inputFile);
-    printf("Total Branches: %d\n", total_branches);
-    printf("Mispredictions: %d\n", mispredictions);
-    printf("Misprediction Rate: %.4f\n", misprediction_rate*100);
+static bool local_shared_fsm_btb_missed(const void* state) {
+    return ((const LocalSharedFSM*)state)->way < 0;
+}
 
-    fclose(file);
-    free(btb);
-    free(shared_counters);
-    return 0;
+static BTB* local_shared_fsm_target_btb(void* state) {
+    return &((LocalSharedFSM*)state)->btb;
 }
+
+// The shared counter is picked by the entry's history, so only the BTB set is known ahead
+static void local_shared_fsm_prefetch(const void* state, uint64_t branch_address) {
+    btb_prefetch(&((const LocalSharedFSM*)state)->btb, branch_address);
+}
+
+const PredictorType local_shared_fsm_predictor = {
+    "Local_shared_FSM",
+    local_shared_fsm_init,
+    local_shared_fsm_predict,
+    local_shared_fsm_update,
+    local_shared_fsm_stats,
+    local_shared_fsm_destroy,
+    local_shared_fsm_save,
+    local_shared_fsm_load,
+    NULL,
+    local_shared_fsm_btb_missed,
+    local_shared_fsm_target_btb,
+    local_shared_fsm_prefetch,
+};
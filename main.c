@@ -2,106 +2,385 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "benchmark.h"
+#include "config.h"
+#include "filter_file.h"
+#include "predictor.h"
+#include "pipeline.h"
+#include "results.h"
+#include "shards.h"
+#include "sweep.h"
+#include "trace_cache.h"
+#include "trace_list.h"
+#include "worker_pool.h"
 
-// Function to trim whitespace from the beginning and end of a string
-char* trim_whitespace(char* str) {
-   
-    while (isspace((unsigned char)*str)) str++;
-    char* end = str + strlen(str) - 1;
-    
-    while (end > str && isspace((unsigned char)*end)) end--;
-    *(end + 1) = '\0';
+#define DEFAULT_CONFIG_FILE "BTBConfiguration.txt"
 
-    return str;
+// Filter-plus-predict run for one trace; everything it touches is private to the job
+typedef struct {
+    const char* trace;
+    char filtered[2 * CONFIG_PATH_LENGTH];
+    bool reused;                // The filtered trace came from the filter cache
+    PredictorConfig sizing;
+    Predictor predictors[MAX_PREDICTORS];
+    int count;
+    int filter_result;
+    int result;
+} TraceJob;
+
+typedef struct {
+    const Config* config;
+    TraceJob* jobs;
+} TraceJobs;
+
+// Checkpoints are kept per trace as <directory>/<trace file name>.ckpt
+static void checkpoint_path(char* path, size_t size, const char* directory, const char* trace)
+{
+    snprintf(path, size, "%s/%s.ckpt", directory, trace_base_name(trace));
+}
+
+static bool profiling(const Config* config)
+{
+    return config->profile_top > 0 || config->profile_csv[0] != '\0';
 }
 
-// Function to read configuration from a file and set variables
-void read_config(int* ghr_bits, int* bhr_bits, int* entries, int* which_predictor) {
-    FILE* file = fopen("BTBConfiguration.txt", "r");
-    if (!file) {
-        perror("Failed to open configuration file");
-        exit(EXIT_FAILURE);
+// Prints the worst branches of every predictor and writes all of them to <profile_csv>/<trace file name>.profile.csv
+static int report_profiles(const Config* config, const TraceJob* job)
+{
+    for (int i = 0; i < job->count; i++)
+    {
+        if (config->profile_top > 0 && job->predictors[i].profile)
+        {
+            branch_profile_print_top(job->predictors[i].profile, job->predictors[i].name, job->trace, config->profile_top);
+        }
+    }
+    if (config->profile_csv[0] == '\0')
+    {
+        return 0;
     }
 
-    char line[256];
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '#' || strlen(trim_whitespace(line)) == 0) {
-            continue;
+    char path[2 * CONFIG_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s.profile.csv", config->profile_csv, trace_base_name(job->trace));
+    FILE* out = fopen(path, "w");
+    if (!out)
+    {
+        perror("Failed to open branch profile file");
+        return 1;
+    }
+    fputs(BRANCH_PROFILE_CSV_HEADER, out);
+    int result = 0;
+    for (int i = 0; i < job->count; i++)
+    {
+        if (job->predictors[i].profile && branch_profile_write_csv(job->predictors[i].profile, job->predictors[i].name, out))
+        {
+            result = 1;
         }
+    }
+    fclose(out);
+    printf("Branch profile has been written to %s\n", path);
+    return result;
+}
+
+static void run_trace_job(void* context, int index)
+{
+    TraceJobs* all = (TraceJobs*)context;
+    const Config* config = all->config;
+    TraceJob* job = &all->jobs[index];
 
-        char* key = strtok(line, "=");
-        char* value = strtok(NULL, "=");
+    job->result = 1;
+    job->filter_result = 0;
+    PredictorConfig* sizing = &job->sizing;
+    config_predictor_sizing(config, config->ghr_bits.values[0], config->bhr_bits.values[0], config->entries.values[0], sizing);
+    sizing->targets = config->targets != 0;
+    job->count = create_predictors(job->predictors, config->which_predictor, sizing);
+    if (job->count == 0)
+    {
+        return;
+    }
+    set_warmup_branches(job->predictors, job->count, config->warmup_branches);
+    if (profiling(config) && enable_branch_profiles(job->predictors, job->count))
+    {
+        return;
+    }
+    if (config->targets && enable_target_prediction(job->predictors, job->count, sizing))
+    {
+        return;
+    }
 
-        if (key && value) {
-            key = trim_whitespace(key);
-            value = trim_whitespace(value);
+    char path[2 * CONFIG_PATH_LENGTH];
+    if (config->checkpoint_in[0])
+    {
+        checkpoint_path(path, sizeof(path), config->checkpoint_in, job->trace);
+        if (LoadCheckpoint(path, job->predictors, job->count))
+        {
+            fprintf(stderr, "Failed to restore %s\n", path);
+            return;
+        }
+    }
 
-            // Assign the appropriate variable based on the key
-            if (strcmp(key, "ghr_bits") == 0) {
-                *ghr_bits = atoi(value);
-            }
-            else if (strcmp(key, "bhr_bits") == 0) {
-                *bhr_bits = atoi(value);
-            }
-            else if (strcmp(key, "entries") == 0) {
-                *entries = atoi(value);
+    if (config->streaming)
+    {
+        job->result = StreamPredictors(job->trace, job->predictors, job->count);
+    }
+    else
+    {
+        if (config->filter_cache[0])
+        {
+            job->filter_result = filter_cached(job->trace, config->filter_cache, index, job->filtered, sizeof(job->filtered), &job->reused);
+        }
+        else
+        {
+            job->filter_result = filterBranchCommands(job->trace, job->filtered);
+        }
+        if (job->filter_result == 0)
+        {
+            job->result = RunPredictors(job->filtered, job->predictors, job->count);
+        }
+    }
+
+    if (job->result == 0 && config->checkpoint_out[0])
+    {
+        checkpoint_path(path, sizeof(path), config->checkpoint_out, job->trace);
+        job->result = SaveCheckpoint(path, job->predictors, job->count);
+    }
+}
+
+static void print_usage(const char* program)
+{
+    printf("Usage: %s [options] [trace ...]\n"
+        "Simulates the branch predictors on riscvOVPsim traces; wildcards such as traces/*.trc are expanded.\n"
+        "  -c, --config FILE       Read the configuration from FILE instead of " DEFAULT_CONFIG_FILE "\n"
+        "  -m, --manifest FILE     Add the traces listed in FILE, one path or pattern per line\n"
+        "  -s, --set KEY=VALUE     Override a configuration key, e.g. -s which_predictor=3\n"
+        "  -o, --output-dir DIR    Write the filtered traces to DIR (filtered_dir)\n"
+        "      --cache DIR         Reuse filtered traces cached in DIR by content hash (filter_cache)\n"
+        "      --results FILE      Write one CSV row per trace and predictor to FILE, JSON for *.json (results_output)\n"
+        "  -h, --help              Show this help\n"
+        "Without traces the four benchmark traces in the current directory are simulated.\n",
+        program);
+}
+
+// Option value following argv[*index], or NULL with a message when it is missing
+static const char* option_value(int argc, char** argv, int* index)
+{
+    if (*index + 1 >= argc)
+    {
+        fprintf(stderr, "Option %s needs a value\n", argv[*index]);
+        return NULL;
+    }
+    return argv[++*index];
+}
+
+static bool is_option(const char* arg, const char* short_name, const char* long_name)
+{
+    return (short_name && strcmp(arg, short_name) == 0) || strcmp(arg, long_name) == 0;
+}
+
+// Reads the configuration and the trace list from the command line. Overrides are applied in
+// order after the configuration file, whichever order the options were given in.
+static int parse_arguments(int argc, char** argv, Config* config, TraceList* traces)
+{
+    const char* config_file = DEFAULT_CONFIG_FILE;
+    for (int i = 1; i < argc; i++)
+    {
+        if (is_option(argv[i], "-c", "--config") && i + 1 < argc)
+        {
+            config_file = argv[++i];
+        }
+    }
+    read_config(config, config_file);
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = NULL;
+        int result = 0;
+        if (is_option(arg, "-h", "--help"))
+        {
+            print_usage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else if (is_option(arg, "-c", "--config"))
+        {
+            result = option_value(argc, argv, &i) == NULL;
+        }
+        else if (is_option(arg, "-m", "--manifest"))
+        {
+            result = (value = option_value(argc, argv, &i)) == NULL || trace_list_add_manifest(traces, value);
+        }
+        else if (is_option(arg, "-s", "--set"))
+        {
+            result = (value = option_value(argc, argv, &i)) == NULL || config_override(config, value);
+        }
+        else if (is_option(arg, "-o", "--output-dir"))
+        {
+            if ((value = option_value(argc, argv, &i)) == NULL)
+            {
+                return 1;
             }
-            else if (strcmp(key, "which_predictor") == 0) {
-                *which_predictor = atoi(value);
+            snprintf(config->filtered_dir, sizeof(config->filtered_dir), "%s", value);
+        }
+        else if (is_option(arg, NULL, "--cache"))
+        {
+            if ((value = option_value(argc, argv, &i)) == NULL)
+            {
+                return 1;
             }
-            else {
-                printf("Unknown configuration key: %s\n", key);
+            snprintf(config->filter_cache, sizeof(config->filter_cache), "%s", value);
+        }
+        else if (is_option(arg, NULL, "--results"))
+        {
+            if ((value = option_value(argc, argv, &i)) == NULL)
+            {
+                return 1;
             }
+            snprintf(config->results_output, sizeof(config->results_output), "%s", value);
+        }
+        else if (arg[0] == '-' && arg[1] != '\0')
+        {
+            fprintf(stderr, "Unknown option %s\n", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            result = trace_list_add_pattern(traces, arg);
+        }
+        if (result)
+        {
+            return 1;
         }
     }
 
-    fclose(file);
+    if (traces->count == 0)
+    {
+        const char* files[4] = { "coremark_val.trc","dhrystone_val.trc","fibonacci_val.trc","linpack_val.trc" };
+        for (int index = 0; index < 4; index++)
+        {
+            if (trace_list_add(traces, files[index]))
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
 }
 
-int main()
+static int run_traces(const Config* config, const char* const* traces, int trace_count)
 {
-    const char* files[4] = { "coremark_val.trc","dhrystone_val.trc","fibonacci_val.trc","linpack_val.trc" };
-    const char *filesFilterd[4] = { "coremark_val_filtered.trc","dhrystone_val_filtered.trc","fibonacci_val_filtered.trc","linpack_val_filtered.trc" };
-
-    int ghr_bits = 0;
-	int bhr_bits = 0;
-	int entries = 0;
-	int which_predictor = 0;
-    read_config(&ghr_bits, &bhr_bits, &entries, &which_predictor);
+    TraceJob* jobs = (TraceJob*)calloc(trace_count, sizeof(TraceJob));
+    if (!jobs)
+    {
+        perror("Failed to allocate memory for trace jobs");
+        return 1;
+    }
+    for (int index = 0; index < trace_count; index++)
+    {
+        jobs[index].trace = traces[index];
+        filtered_trace_path(jobs[index].filtered, sizeof(jobs[index].filtered), traces[index], config->filtered_dir);
+    }
 
-    for (int index = 0; index < 4; index++)
+    ResultsSink results;
+    bool writing_results = config->results_output[0] != '\0';
+    if (writing_results && results_open(&results, config->results_output))
     {
-        FilterFile(files[index], filesFilterd[index]);
+        free(jobs);
+        return 1;
     }
-    
-    switch (which_predictor)
+
+    // Each trace is independent, so traces run concurrently and are reported in a fixed order
+    TraceJobs all = { config, jobs };
+    run_jobs(run_trace_job, &all, trace_count, config->threads);
+
+    int status = 0;
+
+    if (!config->streaming)
     {
-        case 0: //LOCAL_PRIVATE_FSM
-            for (int index = 0; index < 4; index++)
+        for (int index = 0; index < trace_count; index++)
+        {
+            if (jobs[index].filter_result != 0)
             {
-                Local_private_FSM(filesFilterd[index], bhr_bits, entries);
-            }
-            break;
-        case 1: //LOCAL_SHARES_FSM
-            for (int index = 0; index < 4; index++)
+                continue;
+            }
+            if (jobs[index].reused)
             {
-                Local_shared_FSM(filesFilterd[index]);
-            }
-            break;
-        case 2: // GLOBAL
-            for (int index = 0; index < 4; index++)
+                printf("Reusing cached filtered trace %s for %s\n", jobs[index].filtered, jobs[index].trace);
+            }
+            else
             {
-                Global(filesFilterd[index], ghr_bits);
-            }
-            break;
-        case 3: //TOURNAMENT
-            for (int index = 0; index < 4; index++)
+                printf("Filtered branch commands have been written to %s\n", jobs[index].filtered);
+            }
+        }
+    }
+    for (int index = 0; index < trace_count; index++)
+    {
+        if (jobs[index].result == 0)
+        {
+            // Cache entries are named by hash, so those results are labelled with the trace instead
+            const char* label = config->streaming || config->filter_cache[0] ? jobs[index].trace : jobs[index].filtered;
+            PrintResults(label, jobs[index].predictors, jobs[index].count);
+            for (int i = 0; writing_results && i < jobs[index].count; i++)
             {
-                Tournament(filesFilterd[index]);
-            }
-            break;
-        default:
-            break;
-    }
-	return 0;
-}
\ No newline at end of file
+                ResultRow row;
+                result_row_from_predictor(&row, jobs[index].trace, &jobs[index].predictors[i], &jobs[index].sizing, config->warmup_branches);
+                results_write(&results, &row);
+            }
+            if (profiling(config) && report_profiles(config, &jobs[index]))
+            {
+                status = 1;
+            }
+        }
+        else
+        {
+            status = 1;
+        }
+        destroy_predictors(jobs[index].predictors, jobs[index].count);
+    }
+    if (writing_results)
+    {
+        if (results_close(&results))
+        {
+            fprintf(stderr, "Failed to write %s\n", config->results_output);
+            status = 1;
+        }
+        else
+        {
+            printf("Results have been written to %s\n", config->results_output);
+        }
+    }
+    free(jobs);
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    Config config;
+    TraceList traces;
+    trace_list_init(&traces);
+    if (parse_arguments(argc, argv, &config, &traces))
+    {
+        trace_list_free(&traces);
+        return 1;
+    }
+
+    const char* const* files = (const char* const*)traces.paths;
+    int status;
+    if (config.benchmark > 0)
+    {
+        status = RunBenchmark(&config);
+    }
+    else if (config_is_sweep(&config))
+    {
+        status = RunSweep(&config, files, traces.count);
+    }
+    else if (config.shards > 1)
+    {
+        status = RunSharded(&config, files, traces.count);
+    }
+    else
+    {
+        status = run_traces(&config, files, traces.count);
+    }
+    trace_list_free(&traces);
+	return status;
+}
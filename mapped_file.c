@@ -0,0 +1,99 @@
+#define _CRT_SECURE_NO_WARNINGS
+#define _DEFAULT_SOURCE // mmap flags and madvise under -std=c11
+#include <stdio.h>
+#include <stdlib.h>
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+int map_file(MappedFile* mapped, const char* path) {
+    mapped->data = NULL;
+    mapped->size = 0;
+    mapped->mapping = NULL;
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mapped->file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "Failed to open file %s\n", path);
+        return 1;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped->file, &size)) {
+        fprintf(stderr, "Failed to get the size of %s\n", path);
+        CloseHandle(mapped->file);
+        return 1;
+    }
+    mapped->size = (size_t)size.QuadPart;
+    if (mapped->size == 0) {
+        return 0; // Nothing to map, an empty view is still a valid file
+    }
+
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapped->mapping) {
+        mapped->data = (const char*)MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    if (!mapped->data) {
+        fprintf(stderr, "Failed to map file %s\n", path);
+        if (mapped->mapping) CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return 1;
+    }
+    return 0;
+}
+
+void unmap_file(MappedFile* mapped) {
+    if (mapped->data) UnmapViewOfFile(mapped->data);
+    if (mapped->mapping) CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+}
+
+#else
+
+int map_file(MappedFile* mapped, const char* path) {
+    mapped->data = NULL;
+    mapped->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open file");
+        return 1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        perror("Failed to get file size");
+        close(fd);
+        return 1;
+    }
+    mapped->size = (size_t)info.st_size;
+
+    if (mapped->size > 0) {
+        void* data = mmap(NULL, mapped->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror("Failed to map file");
+            close(fd);
+            return 1;
+        }
+        // Traces are scanned front to back exactly once
+        madvise(data, mapped->size, MADV_SEQUENTIAL);
+        mapped->data = (const char*)data;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    return 0;
+}
+
+void unmap_file(MappedFile* mapped) {
+    if (mapped->data) munmap((void*)mapped->data, mapped->size);
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Read-only view of a whole file mapped into memory
+typedef struct {
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+int map_file(MappedFile* mapped, const char* path);
+void unmap_file(MappedFile* mapped);
+
+#endif
@@ -0,0 +1,137 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "checkpoint.h"
+#include "history.h"
+#include "predictor.h"
+
+// Perceptron predictor (Jimenez and Lin): each branch hashes to a vector of signed weights, one
+// per global history bit plus a bias, and is predicted taken when the dot product with the history
+// (taken = +1, not taken = -1) is non-negative. The history length is ghr_bits.
+
+#define PERCEPTRON_ROWS 1024
+#define PERCEPTRON_WEIGHT_MAX 127
+#define PERCEPTRON_WEIGHT_MIN -128
+
+typedef struct {
+    int8_t* weights;            // PERCEPTRON_ROWS rows of history_length + 1 weights, bias first
+    GlobalHistory history;
+    int history_length;
+    int threshold;              // Keep training while |output| is at most this, even when correct
+    int8_t* row;                // Perceptron of the branch being predicted, reused by the update
+    int output;
+} PerceptronPredictor;
+
+static bool perceptron_predict(void* state, uint64_t branch_address) {
+    PerceptronPredictor* predictor = (PerceptronPredictor*)state;
+    size_t row = (size_t)((branch_address >> 1) % PERCEPTRON_ROWS);
+    int8_t* weights = predictor->weights + row * (predictor->history_length + 1);
+
+    int output = weights[0];
+    for (int i = 0; i < predictor->history_length; i++) {
+        output += history_bit(&predictor->history, i) ? weights[i + 1] : -weights[i + 1];
+    }
+
+    predictor->row = weights;
+    predictor->output = output;
+    return output >= 0;
+}
+
+static void train_weight(int8_t* weight, bool agree) {
+    if (agree) {
+        if (*weight < PERCEPTRON_WEIGHT_MAX) (*weight)++;
+    }
+    else {
+        if (*weight > PERCEPTRON_WEIGHT_MIN) (*weight)--;
+    }
+}
+
+static void perceptron_update(void* state, uint64_t branch_address, bool taken) {
+    PerceptronPredictor* predictor = (PerceptronPredictor*)state;
+    int8_t* weights = predictor->row;
+    int magnitude = predictor->output < 0 ? -predictor->output : predictor->output;
+
+    if ((predictor->output >= 0) != taken || magnitude <= predictor->threshold) {
+        train_weight(&weights[0], taken);
+        for (int i = 0; i < predictor->history_length; i++) {
+            train_weight(&weights[i + 1], history_bit(&predictor->history, i) == taken);
+        }
+    }
+
+    history_push(&predictor->history, taken);
+}
+
+static void perceptron_stats(const void* state, PredictorStats* stats) {
+    const PerceptronPredictor* predictor = (const PerceptronPredictor*)state;
+    stats->storage_bits = (uint64_t)PERCEPTRON_ROWS * (predictor->history_length + 1) * 8 + predictor->history_length;
+    stats->memory_bytes = (uint64_t)PERCEPTRON_ROWS * (predictor->history_length + 1);
+}
+
+static void perceptron_destroy(void* state) {
+    PerceptronPredictor* predictor = (PerceptronPredictor*)state;
+    history_free(&predictor->history);
+    free(predictor->weights);
+    free(predictor);
+}
+
+static int perceptron_save(const void* state, FILE* file) {
+    const PerceptronPredictor* predictor = (const PerceptronPredictor*)state;
+    return checkpoint_write_u64(file, (uint64_t)predictor->history_length)
+        || checkpoint_write(file, predictor->weights, (size_t)PERCEPTRON_ROWS * (predictor->history_length + 1))
+        || history_save(&predictor->history, file);
+}
+
+static int perceptron_load(void* state, FILE* file) {
+    PerceptronPredictor* predictor = (PerceptronPredictor*)state;
+    return checkpoint_expect(file, (uint64_t)predictor->history_length, "perceptron history length")
+        || checkpoint_read(file, predictor->weights, (size_t)PERCEPTRON_ROWS * (predictor->history_length + 1))
+        || history_load(&predictor->history, file);
+}
+
+static int perceptron_init(void** predictor_state, const PredictorConfig* config) {
+    int history_length = config->ghr_bits;
+    if (history_length < 1) {
+        fprintf(stderr, "Perceptron needs ghr_bits of at least 1, not %d\n", history_length);
+        return 1;
+    }
+
+    PerceptronPredictor* state = (PerceptronPredictor*)calloc(1, sizeof(PerceptronPredictor));
+    if (!state) {
+        perror("Failed to allocate memory for perceptron predictor");
+        return 1;
+    }
+
+    state->history_length = history_length;
+    state->threshold = (int)(1.93 * history_length + 14); // Training threshold from the original paper
+    state->weights = (int8_t*)calloc((size_t)PERCEPTRON_ROWS * (history_length + 1), sizeof(int8_t));
+    if (!state->weights) {
+        perror("Failed to allocate memory for perceptron weights");
+        free(state);
+        return 1;
+    }
+    if (history_init(&state->history, history_length)) {
+        free(state->weights);
+        free(state);
+        return 1;
+    }
+
+    *predictor_state = state;
+    return 0;
+}
+
+const PredictorType perceptron_predictor = {
+    "Perceptron",
+    perceptron_init,
+    perceptron_predict,
+    perceptron_update,
+    perceptron_stats,
+    perceptron_destroy,
+    perceptron_save,
+    perceptron_load,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
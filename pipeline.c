@@ -0,0 +1,54 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdbool.h>
+#include "branch_queue.h"
+#include "filter_file.h"
+#include "pipeline.h"
+#include "threads.h"
+
+typedef struct {
+    const char* traceFile;
+    BranchQueue* queue;
+} FilterJob;
+
+static void filter_thread(void* argument) {
+    FilterJob* job = (FilterJob*)argument;
+    BranchSink sink = branch_queue_sink(job->queue);
+
+    int result = filterBranchRecords(job->traceFile, &sink);
+    branch_queue_close(job->queue, result != 0);
+}
+
+int StreamPredictors(const char* traceFile, Predictor* predictors, int count) {
+    BranchQueue* queue = branch_queue_create();
+    if (!queue) {
+        return 1;
+    }
+
+    FilterJob job;
+    job.traceFile = traceFile;
+    job.queue = queue;
+
+    Thread filter;
+    if (thread_start(&filter, filter_thread, &job)) {
+        branch_queue_destroy(queue);
+        return 1;
+    }
+
+    // Prediction overlaps with filtering; the queue bounds how far the filter can run ahead
+    BranchSource source = branch_queue_source(queue);
+    int result = RunPredictorsFromSource(traceFile, &source, predictors, count);
+
+    // A consumer that gave up must release the filter, which may be waiting for room in the queue
+    if (result != 0) {
+        branch_queue_cancel(queue);
+    }
+    thread_join(&filter);
+    if (result == 0 && branch_queue_failed(queue)) {
+        fprintf(stderr, "Filtering %s failed, results are incomplete\n", traceFile);
+        result = 1;
+    }
+
+    branch_queue_destroy(queue);
+    return result;
+}
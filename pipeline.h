@@ -0,0 +1,10 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "predictor.h"
+
+// Filters traceFile on a helper thread and streams its branch records straight into the
+// predictors through a bounded ring buffer, without writing a filtered file
+int StreamPredictors(const char* traceFile, Predictor* predictors, int count);
+
+#endif
@@ -0,0 +1,481 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch_trace.h"
+#include "checkpoint.h"
+#include "predictor.h"
+#include "process_stats.h"
+
+#define SIMULATION_BATCH_SIZE 4096
+
+static double misprediction_rate(const Predictor* predictor) {
+    if (predictor->total_branches == 0) return 0.0;
+    return (double)predictor->mispredictions / predictor->total_branches * 100;
+}
+
+
+static void print_target_results(const Predictor* predictors, int count) {
+    if (count == 1) {
+        const TargetPredictor* targets = predictors[0].targets;
+        printf("Target Mispredictions: %llu\n", (unsigned long long)targets->target_mispredictions);
+        printf("Indirect Branches: %llu\n", (unsigned long long)targets->indirect_branches);
+        printf("Indirect Mispredictions: %llu\n", (unsigned long long)targets->indirect_mispredictions);
+        printf("Calls: %llu\n", (unsigned long long)targets->calls);
+        printf("Returns: %llu\n", (unsigned long long)targets->return_count);
+        printf("Return Mispredictions: %llu\n", (unsigned long long)targets->return_mispredictions);
+        printf("Return Stack Overflows: %llu\n", (unsigned long long)targets->stack_overflows);
+        printf("Return Stack Underflows: %llu\n", (unsigned long long)targets->stack_underflows);
+        printf("Fetch Redirects: %llu\n", (unsigned long long)predictor_fetch_redirects(&predictors[0]));
+        return;
+    }
+
+    printf("%-20s", "Target Misses:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->target_mispredictions);
+    printf("\n%-20s", "Indirect Branches:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->indirect_branches);
+    printf("\n%-20s", "Indirect Misses:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->indirect_mispredictions);
+    printf("\n%-20s", "Calls:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->calls);
+    printf("\n%-20s", "Returns:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->return_count);
+    printf("\n%-20s", "Return Misses:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->return_mispredictions);
+    printf("\n%-20s", "RAS Overflows:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->stack_overflows);
+    printf("\n%-20s", "RAS Underflows:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].targets->stack_underflows);
+    printf("\n%-20s", "Fetch Redirects:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictor_fetch_redirects(&predictors[i]));
+    printf("\n");
+}
+
+#ifdef PREDICTOR_EVENTS
+// One row per event any of the predictors counted
+static void print_events(const Predictor* predictors, int count) {
+    PredictorStats stats[MAX_PREDICTORS] = { 0 };
+    for (int i = 0; i < count; i++) {
+        predictors[i].type->stats(predictors[i].state, &stats[i]);
+    }
+
+    for (int event = 0; event < EVENT_COUNT; event++) {
+        bool counted = false;
+        for (int i = 0; i < count; i++) counted |= stats[i].events.counts[event] != 0;
+        if (!counted) continue;
+
+        if (count == 1) {
+            printf("%s %llu\n", event_name((PredictorEvent)event), (unsigned long long)stats[0].events.counts[event]);
+            continue;
+        }
+        printf("%-20s", event_name((PredictorEvent)event));
+        for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)stats[i].events.counts[event]);
+        printf("\n");
+    }
+}
+#endif
+
+void PrintResults(const char* inputFile, const Predictor* predictors, int count) {
+    if (count == 1) {
+        printf("\n%s for %s:\n", predictors[0].name, inputFile);
+        printf("Total Branches: %llu\n", (unsigned long long)predictors[0].total_branches);
+        printf("Mispredictions: %llu\n", (unsigned long long)predictors[0].mispredictions);
+        printf("Misprediction Rate: %.4f\n", misprediction_rate(&predictors[0]));
+        if (predictors[0].targets) {
+            print_target_results(predictors, count);
+        }
+#ifdef PREDICTOR_EVENTS
+        print_events(predictors, count);
+#endif
+        return;
+    }
+
+    // One column per predictor so the strategies can be compared at a glance
+    printf("\nResults for %s:\n", inputFile);
+    printf("%-20s", "");
+    for (int i = 0; i < count; i++) printf("%20s", predictors[i].name);
+    printf("\n%-20s", "Total Branches:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].total_branches);
+    printf("\n%-20s", "Mispredictions:");
+    for (int i = 0; i < count; i++) printf("%20llu", (unsigned long long)predictors[i].mispredictions);
+    printf("\n%-20s", "Misprediction Rate:");
+    for (int i = 0; i < count; i++) printf("%20.4f", misprediction_rate(&predictors[i]));
+    printf("\n%-20s", "Storage (KiB):");
+    for (int i = 0; i < count; i++) printf("%20.2f", predictor_storage_bits(&predictors[i]) / 8192.0);
+    printf("\n");
+    if (predictors[0].targets) {
+        print_target_results(predictors, count);
+    }
+#ifdef PREDICTOR_EVENTS
+    print_events(predictors, count);
+#endif
+}
+
+static size_t reader_source_read(void* context, BranchRecord* records, size_t max_records) {
+    return branch_trace_read_batch((BranchTraceReader*)context, records, max_records);
+}
+
+static uint64_t simulate_generic(Predictor* predictor, const BranchRecord* records, size_t record_count) {
+    void (*prefetch)(const void* state, uint64_t address) = predictor->prefetch;
+    if (prefetch) {
+        for (size_t r = 0; r < PREFETCH_DISTANCE && r < record_count; r++) {
+            prefetch(predictor->state, records[r].address);
+        }
+    }
+
+    uint64_t mispredictions = 0;
+    for (size_t r = 0; r < record_count; r++) {
+        const BranchRecord* record = &records[r];
+        // The state of a branch a few records on loads while this one is simulated
+        if (prefetch && r + PREFETCH_DISTANCE < record_count) {
+            prefetch(predictor->state, records[r + PREFETCH_DISTANCE].address);
+        }
+        bool prediction = predictor->type->predict(predictor->state, record->address);
+        predictor->type->update(predictor->state, record->address, record->taken);
+
+        if (prediction != record->taken) {
+            mispredictions++;
+        }
+    }
+    return mispredictions;
+}
+
+// Per-record loop for runs that look beyond the direction outcomes: files every counted outcome in
+// the branch profile and predicts the targets of branches and jumps, whichever are attached
+static void simulate_detailed(Predictor* predictor, const BranchRecord* records, size_t record_count) {
+    const PredictorType* type = predictor->type;
+    TargetPredictor* targets = predictor->targets;
+    for (size_t r = 0; r < record_count; r++) {
+        const BranchRecord* record = &records[r];
+        bool counted = predictor->warmup_branches == 0;
+        if (record->kind != BRANCH_CONDITIONAL) {
+            if (targets) {
+                target_predictor_jump(targets, record, counted);
+            }
+            continue;
+        }
+
+        bool prediction = type->predict(predictor->state, record->address);
+        bool btb_miss = type->btb_missed && type->btb_missed(predictor->state);
+        if (targets) {
+            target_predictor_lookup(targets, record->address);
+        }
+        type->update(predictor->state, record->address, record->taken);
+        if (targets) {
+            target_predictor_update(targets, record, prediction, counted);
+        }
+
+        if (!counted) {
+            predictor->warmup_branches--;
+            continue;
+        }
+        bool mispredicted = prediction != record->taken;
+        predictor->total_branches++;
+        predictor->mispredictions += mispredicted;
+        if (predictor->profile && branch_profile_record(predictor->profile, record->address, record->taken, mispredicted, btb_miss)) {
+            // Out of memory: give up on the profile rather than the simulation
+            fprintf(stderr, "Branch profile of %s dropped\n", predictor->name);
+            branch_profile_destroy(predictor->profile);
+            predictor->profile = NULL;
+        }
+    }
+}
+
+static uint64_t simulate_batch(Predictor* predictor, const BranchRecord* records, size_t record_count) {
+    if (predictor->kernel) {
+        return predictor->kernel(predictor->state, records, record_count);
+    }
+    return simulate_generic(predictor, records, record_count);
+}
+
+// Direction-only simulation of a run of conditional branches
+static void simulate_conditional(Predictor* predictor, const BranchRecord* records, size_t record_count) {
+    // Warm-up branches train the state but their outcomes are dropped
+    size_t warmup = predictor->warmup_branches < record_count ? (size_t)predictor->warmup_branches : record_count;
+    if (warmup > 0) {
+        simulate_batch(predictor, records, warmup);
+        predictor->warmup_branches -= warmup;
+    }
+
+    predictor->mispredictions += simulate_batch(predictor, records + warmup, record_count - warmup);
+    predictor->total_branches += record_count - warmup;
+}
+
+static void simulate_predictor(Predictor* predictor, const BranchRecord* records, size_t record_count) {
+    if (predictor->profile || predictor->targets) {
+        simulate_detailed(predictor, records, record_count);
+        return;
+    }
+
+    // Direction predictors only see conditional branches, so any jumps split the batch into runs
+    size_t start = 0;
+    while (start < record_count) {
+        size_t end = start;
+        while (end < record_count && records[end].kind == BRANCH_CONDITIONAL) end++;
+        if (end > start) {
+            simulate_conditional(predictor, records + start, end - start);
+        }
+        start = end;
+        while (start < record_count && records[start].kind != BRANCH_CONDITIONAL) start++;
+    }
+}
+
+void SimulateRecords(const BranchRecord* records, size_t record_count, Predictor* predictors, int count) {
+    // Predictors are independent, so each one runs over the whole batch in turn
+    for (int i = 0; i < count; i++) {
+        double start = monotonic_seconds();
+        simulate_predictor(&predictors[i], records, record_count);
+        predictors[i].seconds += monotonic_seconds() - start;
+    }
+}
+
+int enable_branch_profiles(Predictor* predictors, int count) {
+    for (int i = 0; i < count; i++) {
+        predictors[i].profile = branch_profile_create();
+        if (!predictors[i].profile) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int enable_target_prediction(Predictor* predictors, int count, const PredictorConfig* config) {
+    for (int i = 0; i < count; i++) {
+        BTB* btb = predictors[i].type->target_btb ? predictors[i].type->target_btb(predictors[i].state) : NULL;
+        predictors[i].targets = target_predictor_create(btb, config->btb_entries, config->btb_ways,
+            config->btb_replacement, config->indirect_bits, config->ras_depth);
+        if (!predictors[i].targets) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void set_warmup_branches(Predictor* predictors, int count, uint64_t warmup_branches) {
+    for (int i = 0; i < count; i++) {
+        predictors[i].warmup_branches = warmup_branches;
+    }
+}
+
+int RunPredictorsFromSource(const char* label, BranchSource* source, Predictor* predictors, int count) {
+    BranchRecord* records = (BranchRecord*)malloc(SIMULATION_BATCH_SIZE * sizeof(BranchRecord));
+    if (!records) {
+        perror("Failed to allocate memory for branch records");
+        return 1;
+    }
+
+    size_t batch;
+    while ((batch = source->read(source->context, records, SIMULATION_BATCH_SIZE)) > 0) {
+        SimulateRecords(records, batch, predictors, count);
+    }
+
+    free(records);
+    return 0;
+}
+
+int RunPredictors(const char* inputFile, Predictor* predictors, int count) {
+    BranchTraceReader* reader = (BranchTraceReader*)malloc(sizeof(BranchTraceReader));
+    if (!reader || branch_trace_open_reader(reader, inputFile)) {
+        free(reader);
+        return 1;
+    }
+
+    BranchSource source;
+    source.context = reader;
+    source.read = reader_source_read;
+    int result = RunPredictorsFromSource(inputFile, &source, predictors, count);
+
+    branch_trace_close_reader(reader);
+    free(reader);
+    return result;
+}
+
+int pht_index_bits(const PredictorConfig* config, int history_bits) {
+    if (config->pht_bits > 0) {
+        return config->pht_bits;
+    }
+    return history_bits < DEFAULT_PHT_BITS ? history_bits : DEFAULT_PHT_BITS;
+}
+
+static const char* chooser_index_names[] = { "pc", "ghr", "pc^ghr" };
+
+int chooser_index_from_name(const char* name, ChooserIndex* index) {
+    for (int i = 0; i < (int)(sizeof(chooser_index_names) / sizeof(chooser_index_names[0])); i++) {
+        if (strcmp(name, chooser_index_names[i]) == 0) {
+            *index = (ChooserIndex)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+const char* chooser_index_name(ChooserIndex index) {
+    return chooser_index_names[index];
+}
+
+// Indexed by which_predictor; the ALL_PREDICTORS slot is a selector, not a predictor
+static const PredictorType* const predictor_types[] = {
+    &local_private_fsm_predictor,
+    &local_shared_fsm_predictor,
+    &global_predictor,
+    &tournament_predictor,
+    NULL,
+    &gshare_predictor,
+    &tage_predictor,
+    &perceptron_predictor,
+};
+
+#define PREDICTOR_TYPE_COUNT ((int)(sizeof(predictor_types) / sizeof(predictor_types[0])))
+
+static int create_predictor(Predictor* predictor, const PredictorType* type, const PredictorConfig* config) {
+    predictor->type = type;
+    predictor->name = type->name;
+    predictor->total_branches = 0;
+    predictor->mispredictions = 0;
+    predictor->seconds = 0;
+    predictor->kernel = NULL;
+    predictor->prefetch = NULL;
+    predictor->warmup_branches = 0;
+    predictor->profile = NULL;
+    predictor->targets = NULL;
+    if (type->init(&predictor->state, config)) {
+        return 1;
+    }
+
+    // Build with -DPREDICTOR_GENERIC_ONLY to check the specialised kernels against the generic loop.
+    // The kernels do not count events, so event builds never use them.
+#if !defined(PREDICTOR_GENERIC_ONLY) && !defined(PREDICTOR_EVENTS)
+    if (type->select_kernel) {
+        predictor->kernel = type->select_kernel(predictor->state);
+    }
+#endif
+    if (type->prefetch) {
+        PredictorStats stats = { 0 };
+        type->stats(predictor->state, &stats);
+        if (stats.memory_bytes >= PREFETCH_MIN_BYTES) {
+            predictor->prefetch = type->prefetch;
+        }
+    }
+    return 0;
+}
+
+int create_predictors(Predictor* predictors, int which_predictor, const PredictorConfig* config) {
+    if (which_predictor < 0 || which_predictor >= PREDICTOR_TYPE_COUNT) {
+        fprintf(stderr, "Unknown predictor: %d\n", which_predictor);
+        return 0;
+    }
+
+    if (which_predictor != ALL_PREDICTORS) {
+        return create_predictor(&predictors[0], predictor_types[which_predictor], config) ? 0 : 1;
+    }
+
+    int count = 0;
+    for (int i = 0; i < PREDICTOR_TYPE_COUNT; i++) {
+        if (i == ALL_PREDICTORS) continue;
+        if (create_predictor(&predictors[count], predictor_types[i], config)) {
+            destroy_predictors(predictors, count);
+            return 0;
+        }
+        count++;
+    }
+    return count;
+}
+
+void destroy_predictors(Predictor* predictors, int count) {
+    for (int i = 0; i < count; i++) {
+        predictors[i].type->destroy(predictors[i].state);
+        branch_profile_destroy(predictors[i].profile);
+        target_predictor_destroy(predictors[i].targets);
+    }
+}
+
+uint64_t predictor_storage_bits(const Predictor* predictor) {
+    PredictorStats stats = { 0 };
+    predictor->type->stats(predictor->state, &stats);
+    return stats.storage_bits + (predictor->targets ? target_predictor_storage_bits(predictor->targets) : 0);
+}
+
+uint64_t predictor_memory_bytes(const Predictor* predictor) {
+    PredictorStats stats = { 0 };
+    predictor->type->stats(predictor->state, &stats);
+    return stats.memory_bytes + (predictor->targets ? target_predictor_memory_bytes(predictor->targets) : 0);
+}
+
+// Every mispredicted direction, missing or wrong target and mispredicted jump or return redirects the fetch
+uint64_t predictor_fetch_redirects(const Predictor* predictor) {
+    return predictor->mispredictions + (predictor->targets ? target_predictor_mispredictions(predictor->targets) : 0);
+}
+
+int SaveCheckpoint(const char* path, const Predictor* predictors, int count) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror("Error opening checkpoint file");
+        return 1;
+    }
+
+    int result = checkpoint_write(file, CHECKPOINT_MAGIC, 4)
+        || checkpoint_write_u64(file, CHECKPOINT_VERSION)
+        || checkpoint_write_u64(file, (uint64_t)count);
+    for (int i = 0; i < count && result == 0; i++) {
+        size_t name_length = strlen(predictors[i].name);
+        result = checkpoint_write_u64(file, name_length)
+            || checkpoint_write(file, predictors[i].name, name_length)
+            || predictors[i].type->save(predictors[i].state, file)
+            || checkpoint_write_u64(file, predictors[i].targets ? 1 : 0)
+            || (predictors[i].targets && target_predictor_save(predictors[i].targets, file));
+    }
+
+    if (fclose(file) != 0 && result == 0) {
+        perror("Failed to write checkpoint");
+        result = 1;
+    }
+    return result;
+}
+
+// Checks the next predictor name in the file against the predictor about to be restored
+static int expect_predictor_name(FILE* file, const char* name) {
+    char saved[64];
+    uint64_t length;
+    if (checkpoint_read_u64(file, &length)) {
+        return 1;
+    }
+    if (length >= sizeof(saved) || checkpoint_read(file, saved, (size_t)length)) {
+        fprintf(stderr, "Checkpoint has an invalid predictor name\n");
+        return 1;
+    }
+    saved[length] = '\0';
+    if (strcmp(saved, name) != 0) {
+        fprintf(stderr, "Checkpoint holds %s where %s was expected\n", saved, name);
+        return 1;
+    }
+    return 0;
+}
+
+int LoadCheckpoint(const char* path, Predictor* predictors, int count) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror("Error opening checkpoint file");
+        return 1;
+    }
+
+    char magic[4];
+    int result = checkpoint_read(file, magic, sizeof(magic));
+    if (result == 0 && memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+        fprintf(stderr, "%s is not a predictor checkpoint\n", path);
+        result = 1;
+    }
+    result = result
+        || checkpoint_expect(file, CHECKPOINT_VERSION, "checkpoint version")
+        || checkpoint_expect(file, (uint64_t)count, "predictor count");
+    for (int i = 0; i < count && result == 0; i++) {
+        result = expect_predictor_name(file, predictors[i].name)
+            || predictors[i].type->load(predictors[i].state, file)
+            || checkpoint_expect(file, predictors[i].targets ? 1 : 0, "target prediction")
+            || (predictors[i].targets && target_predictor_load(predictors[i].targets, file));
+    }
+
+    fclose(file);
+    return result;
+}
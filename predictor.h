@@ -0,0 +1,147 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "branch_profile.h"
+#include "branch_trace.h"
+#include "btb.h"
+#include "events.h"
+#include "target_predictor.h"
+
+// What the Tournament chooser is indexed with
+typedef enum {
+    CHOOSER_INDEX_PC = 0,       // Branch address
+    CHOOSER_INDEX_GHR,          // Global history
+    CHOOSER_INDEX_PC_XOR_GHR    // Branch address XOR global history
+} ChooserIndex;
+
+#define DEFAULT_CHOOSER_BITS 10
+#define DEFAULT_INDIRECT_BITS 10
+#define DEFAULT_RAS_DEPTH 16
+
+// Sizing shared by the predictors; each one uses the fields that apply to it
+typedef struct {
+    int ghr_bits;
+    int bhr_bits;
+    int pht_bits;           // Index bits of global-history counter tables, 0 = ghr_bits up to DEFAULT_PHT_BITS
+    int btb_entries;
+    int btb_ways;
+    BTBReplacement btb_replacement;
+    int chooser_bits;       // Tournament chooser has 2^chooser_bits counters
+    ChooserIndex chooser_index;
+    bool targets;           // BTB entries keep branch targets for the target predictor (see target_predictor.h)
+    int indirect_bits;      // Indirect target cache has 2^indirect_bits entries
+    int ras_depth;          // Return address stack entries, 0 = returns use the indirect target cache
+} PredictorConfig;
+
+#define DEFAULT_PHT_BITS 24
+
+// Index bits of a counter table read through history_bits of global history: pht_bits when set,
+// otherwise the history length capped at DEFAULT_PHT_BITS. Longer histories are folded to fit.
+int pht_index_bits(const PredictorConfig* config, int history_bits);
+
+// Parses "pc", "ghr" or "pc^ghr"; returns 1 for anything else
+int chooser_index_from_name(const char* name, ChooserIndex* index);
+const char* chooser_index_name(ChooserIndex index);
+
+// Predictor-specific figures reported by PredictorType.stats
+typedef struct {
+    uint64_t storage_bits;  // Bits of predictor state a hardware implementation would need
+    uint64_t memory_bytes;  // Bytes of tables the simulator allocated for it
+    EventCounters events;   // Counted in -DPREDICTOR_EVENTS builds only (see events.h)
+} PredictorStats;
+
+// Simulates a batch of records on a predictor's state; returns the number of mispredictions
+typedef uint64_t (*PredictorKernel)(void* state, const BranchRecord* records, size_t count);
+
+// The operations every predictor implements. For each branch the simulator calls predict and then
+// update with the actual outcome, so update may reuse lookups cached by the predict call before it.
+// save and load checkpoint the full state (see checkpoint.h); load restores into a predictor created
+// with the same configuration and fails otherwise.
+// select_kernel may return a batch loop specialised for the state's exact configuration (see
+// kernel_template.h); it must give the same results as predict/update. NULL means none exists.
+// btb_missed tells whether the last predict missed in the BTB, for profiles; NULL without a BTB.
+// target_btb returns the BTB the target predictor keeps targets in; NULL without a BTB, in which
+// case the target predictor brings its own.
+// prefetch starts loading the state predict will read for a branch at address that is
+// PREFETCH_DISTANCE records ahead; it must not change any state. Only the parts indexed by the
+// address alone can be fetched that early, so NULL when every lookup depends on the history.
+typedef struct {
+    const char* name;
+    int (*init)(void** state, const PredictorConfig* config);   // Allocates the state; returns 0 on success
+    bool (*predict)(void* state, uint64_t address);
+    void (*update)(void* state, uint64_t address, bool taken);
+    void (*stats)(const void* state, PredictorStats* stats);
+    void (*destroy)(void* state);
+    int (*save)(const void* state, FILE* file);                 // Returns 0 on success
+    int (*load)(void* state, FILE* file);                       // Returns 0 on success
+    PredictorKernel (*select_kernel)(const void* state);
+    bool (*btb_missed)(const void* state);
+    BTB* (*target_btb)(void* state);
+    void (*prefetch)(const void* state, uint64_t address);
+} PredictorType;
+
+#define PREFETCH_DISTANCE 8            // Records ahead the simulation loop prefetches predictor state for
+#define PREFETCH_MIN_BYTES (1 << 20)    // Least memory_bytes to prefetch for; smaller states stay cached
+
+extern const PredictorType local_private_fsm_predictor;
+extern const PredictorType local_shared_fsm_predictor;
+extern const PredictorType global_predictor;
+extern const PredictorType tournament_predictor;
+extern const PredictorType gshare_predictor;
+extern const PredictorType tage_predictor;
+extern const PredictorType perceptron_predictor;
+
+// A branch predictor instance: its type, private state and the outcome counters of the simulation
+typedef struct {
+    const PredictorType* type;
+    const char* name;
+    void* state;
+    PredictorKernel kernel;     // Specialised batch loop, NULL runs predict/update per record
+    void (*prefetch)(const void* state, uint64_t address);  // type->prefetch for large states, else NULL
+    uint64_t warmup_branches;   // Branches still to simulate before outcomes are counted
+    BranchProfile* profile;     // Per-branch statistics of the counted branches, NULL when not profiling
+    TargetPredictor* targets;   // Target prediction beside the directions, NULL when not tracking targets
+    uint64_t total_branches;
+    uint64_t mispredictions;
+    double seconds;             // Wall time spent simulating it, warm-up included
+} Predictor;
+
+#define MAX_PREDICTORS 7
+#define ALL_PREDICTORS 4   // which_predictor value that selects every predictor
+
+// Creates the predictor(s) selected by which_predictor: 0 Local_private_FSM, 1 Local_shared_FSM, 2 Global,
+// 3 Tournament, 4 all of them, 5 Gshare, 6 TAGE, 7 Perceptron. Returns how many, 0 on error.
+int create_predictors(Predictor* predictors, int which_predictor, const PredictorConfig* config);
+void destroy_predictors(Predictor* predictors, int count);
+uint64_t predictor_storage_bits(const Predictor* predictor);
+uint64_t predictor_memory_bytes(const Predictor* predictor);
+uint64_t predictor_fetch_redirects(const Predictor* predictor);
+
+// Attaches an empty branch profile to every predictor; destroy_predictors frees them
+int enable_branch_profiles(Predictor* predictors, int count);
+
+// Attaches a target predictor to every predictor, sharing its BTB when it has one (created with
+// config->targets); destroy_predictors frees them
+int enable_target_prediction(Predictor* predictors, int count, const PredictorConfig* config);
+
+// Lets the first branches train the predictors without being counted, e.g. after a cold start
+void set_warmup_branches(Predictor* predictors, int count, uint64_t warmup_branches);
+
+// Writes the state of every predictor to a checkpoint file, or restores it. LoadCheckpoint expects
+// the same predictors, in the same order and configuration, as the run that saved the file.
+int SaveCheckpoint(const char* path, const Predictor* predictors, int count);
+int LoadCheckpoint(const char* path, Predictor* predictors, int count);
+
+// Feeds every record of a filtered trace to all predictors in a single pass.
+// Results are left in each predictor's counters so callers decide when to print them.
+int RunPredictors(const char* inputFile, Predictor* predictors, int count);
+int RunPredictorsFromSource(const char* label, BranchSource* source, Predictor* predictors, int count);
+// Adds the outcome of an in-memory run of records to each predictor's counters. Only conditional
+// branches reach the direction predictors; jumps are simulated by the target predictors, if any.
+void SimulateRecords(const BranchRecord* records, size_t record_count, Predictor* predictors, int count);
+void PrintResults(const char* inputFile, const Predictor* predictors, int count);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef PROCESS_STATS_H
+#define PROCESS_STATS_H
+
+#include <stdint.h>
+
+// Seconds from an arbitrary fixed point, for measuring elapsed wall time
+double monotonic_seconds(void);
+
+// Largest resident set the process has had so far, in bytes; 0 if the platform cannot tell
+uint64_t peak_rss_bytes(void);
+
+#endif
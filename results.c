@@ -0,0 +1,141 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "results.h"
+
+static bool has_json_extension(const char* path) {
+    size_t length = strlen(path);
+    return length >= 5 && strcmp(path + length - 5, ".json") == 0;
+}
+
+static void write_json_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (; *text; text++) {
+        unsigned char c = (unsigned char)*text;
+        if (c < 0x20) {
+            fprintf(out, "\\u%04x", c); // JSON strings cannot hold raw control characters
+            continue;
+        }
+        if (c == '"' || c == '\\') fputc('\\', out);
+        fputc(c, out);
+    }
+    fputc('"', out);
+}
+
+// Trace paths may hold commas or quotes; those are quoted the RFC 4180 way
+static void write_csv_string(FILE* out, const char* text) {
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+        fputs(text, out);
+        return;
+    }
+    fputc('"', out);
+    for (; *text; text++) {
+        if (*text == '"') fputc('"', out);
+        fputc(*text, out);
+    }
+    fputc('"', out);
+}
+
+void result_row_from_predictor(ResultRow* row, const char* trace, const Predictor* predictor,
+    const PredictorConfig* sizing, uint64_t warmup_branches) {
+    row->trace = trace;
+    row->predictor = predictor->name;
+    row->sizing = sizing;
+    // A trace shorter than the warm-up leaves part of it unused
+    row->warmup_branches = warmup_branches - predictor->warmup_branches;
+    row->total_branches = predictor->total_branches;
+    row->mispredictions = predictor->mispredictions;
+    row->storage_bits = predictor_storage_bits(predictor);
+    row->memory_bytes = predictor_memory_bytes(predictor);
+    row->seconds = predictor->seconds;
+    row->shards = 0;
+    row->shard_warmup = 0;
+
+    row->targets = predictor->targets != NULL;
+    row->target_mispredictions = row->targets ? predictor->targets->target_mispredictions : 0;
+    row->indirect_mispredictions = row->targets ? predictor->targets->indirect_mispredictions : 0;
+    row->return_mispredictions = row->targets ? predictor->targets->return_mispredictions : 0;
+    row->fetch_redirects = predictor_fetch_redirects(predictor);
+}
+
+// Target counts of a row without target prediction are empty in CSV and null in JSON
+static void write_target_count(const ResultsSink* sink, const ResultRow* row, const char* key, uint64_t count) {
+    if (sink->json) {
+        if (row->targets) fprintf(sink->out, ", \"%s\": %llu", key, (unsigned long long)count);
+        else fprintf(sink->out, ", \"%s\": null", key);
+    }
+    else {
+        if (row->targets) fprintf(sink->out, ",%llu", (unsigned long long)count);
+        else fputc(',', sink->out);
+    }
+}
+
+int results_open(ResultsSink* sink, const char* path) {
+    sink->out = stdout;
+    sink->json = false;
+    sink->first = true;
+    if (path[0] != '\0') {
+        sink->out = fopen(path, "w");
+        if (!sink->out) {
+            perror("Failed to open results file");
+            return 1;
+        }
+        sink->json = has_json_extension(path);
+    }
+
+    if (sink->json) fprintf(sink->out, "[\n");
+    else fprintf(sink->out, "trace,predictor,ghr_bits,bhr_bits,entries,storage_bits,total_branches,mispredictions,misprediction_rate,"
+        "pht_bits,btb_ways,btb_replacement,chooser_bits,chooser_index,warmup_branches,memory_bytes,seconds,branches_per_second,"
+        "shards,shard_warmup,targets,indirect_bits,ras_depth,target_mispredictions,indirect_mispredictions,return_mispredictions,fetch_redirects\n");
+    return 0;
+}
+
+void results_write(ResultsSink* sink, const ResultRow* row) {
+    FILE* out = sink->out;
+    const PredictorConfig* sizing = row->sizing;
+    double misprediction_rate = row->total_branches ? (double)row->mispredictions / row->total_branches * 100 : 0.0;
+    double branches_per_second = row->seconds > 0 ? (row->warmup_branches + row->total_branches) / row->seconds : 0.0;
+
+    if (sink->json) {
+        fprintf(out, "%s  {\"trace\": ", sink->first ? "" : ",\n");
+        write_json_string(out, row->trace);
+        fprintf(out, ", \"predictor\": \"%s\", \"ghr_bits\": %d, \"bhr_bits\": %d, \"entries\": %d, \"storage_bits\": %llu, "
+            "\"total_branches\": %llu, \"mispredictions\": %llu, \"misprediction_rate\": %.4f, "
+            "\"pht_bits\": %d, \"btb_ways\": %d, \"btb_replacement\": \"%s\", \"chooser_bits\": %d, \"chooser_index\": \"%s\", "
+            "\"warmup_branches\": %llu, \"memory_bytes\": %llu, \"seconds\": %.6f, \"branches_per_second\": %.0f, "
+            "\"shards\": %d, \"shard_warmup\": %llu, \"targets\": %d, \"indirect_bits\": %d, \"ras_depth\": %d",
+            row->predictor, sizing->ghr_bits, sizing->bhr_bits, sizing->btb_entries, (unsigned long long)row->storage_bits,
+            (unsigned long long)row->total_branches, (unsigned long long)row->mispredictions, misprediction_rate,
+            sizing->pht_bits, sizing->btb_ways, btb_replacement_name(sizing->btb_replacement), sizing->chooser_bits,
+            chooser_index_name(sizing->chooser_index), (unsigned long long)row->warmup_branches,
+            (unsigned long long)row->memory_bytes, row->seconds, branches_per_second,
+            row->shards, (unsigned long long)row->shard_warmup, row->targets ? 1 : 0, sizing->indirect_bits, sizing->ras_depth);
+    }
+    else {
+        write_csv_string(out, row->trace);
+        fprintf(out, ",%s,%d,%d,%d,%llu,%llu,%llu,%.4f,%d,%d,%s,%d,%s,%llu,%llu,%.6f,%.0f,%d,%llu,%d,%d,%d",
+            row->predictor, sizing->ghr_bits, sizing->bhr_bits, sizing->btb_entries, (unsigned long long)row->storage_bits,
+            (unsigned long long)row->total_branches, (unsigned long long)row->mispredictions, misprediction_rate,
+            sizing->pht_bits, sizing->btb_ways, btb_replacement_name(sizing->btb_replacement), sizing->chooser_bits,
+            chooser_index_name(sizing->chooser_index), (unsigned long long)row->warmup_branches,
+            (unsigned long long)row->memory_bytes, row->seconds, branches_per_second,
+            row->shards, (unsigned long long)row->shard_warmup, row->targets ? 1 : 0, sizing->indirect_bits, sizing->ras_depth);
+    }
+    write_target_count(sink, row, "target_mispredictions", row->target_mispredictions);
+    write_target_count(sink, row, "indirect_mispredictions", row->indirect_mispredictions);
+    write_target_count(sink, row, "return_mispredictions", row->return_mispredictions);
+    write_target_count(sink, row, "fetch_redirects", row->fetch_redirects);
+    fputs(sink->json ? "}" : "\n", out);
+    sink->first = false;
+}
+
+int results_close(ResultsSink* sink) {
+    if (sink->json) fprintf(sink->out, "%s]\n", sink->first ? "" : "\n");
+    if (sink->out == stdout) {
+        return fflush(stdout) != 0;
+    }
+    int failed = ferror(sink->out);
+    return fclose(sink->out) != 0 || failed;
+}
@@ -0,0 +1,56 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "predictor.h"
+
+// Machine-readable results: one row per (trace, predictor, configuration), written as CSV or as a
+// JSON array of objects with the same keys. The columns start with those of the original sweep
+// table, so existing readers keep working, and add the rest of the sizing, the warm-up, the
+// simulator's table memory, the wall time spent simulating, the sharding and, when targets were
+// predicted, the target counts.
+
+typedef struct {
+    const char* trace;
+    const char* predictor;
+    const PredictorConfig* sizing;
+    uint64_t warmup_branches;   // Simulated uncounted before total_branches
+    uint64_t total_branches;
+    uint64_t mispredictions;
+    uint64_t storage_bits;      // Hardware budget, see PredictorStats
+    uint64_t memory_bytes;      // Tables the simulator allocated, target predictor included
+    double seconds;             // Wall time simulating warm-up and counted branches; for a sharded
+                                // run, that of all chunks and predictors together
+    int shards;                 // Chunks simulated in parallel, 0 for a serial run
+    uint64_t shard_warmup;      // Branches replayed before each chunk, 0 for a serial run
+
+    // Target prediction (see target_predictor.h); the counts are left out of the table without it
+    bool targets;
+    uint64_t target_mispredictions;
+    uint64_t indirect_mispredictions;
+    uint64_t return_mispredictions;
+    uint64_t fetch_redirects;
+} ResultRow;
+
+typedef struct {
+    FILE* out;
+    bool json;
+    bool first;
+} ResultsSink;
+
+// Fills a row from a simulated predictor of a serial run; warmup_branches is what it was set to
+// before the run
+void result_row_from_predictor(ResultRow* row, const char* trace, const Predictor* predictor,
+    const PredictorConfig* sizing, uint64_t warmup_branches);
+
+// Opens path for writing, JSON when it ends in .json and CSV otherwise; an empty path writes CSV
+// to stdout. Returns 1 when the file cannot be created.
+int results_open(ResultsSink* sink, const char* path);
+void results_write(ResultsSink* sink, const ResultRow* row);
+
+// Ends the table and closes the file; returns 1 when it could not be written completely
+int results_close(ResultsSink* sink);
+
+#endif
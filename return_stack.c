@@ -0,0 +1,72 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include "checkpoint.h"
+#include "return_stack.h"
+
+int return_stack_init(ReturnStack* stack, int depth) {
+    stack->entries = NULL;
+    stack->depth = depth;
+    stack->top = 0;
+    stack->count = 0;
+    if (depth < 0) {
+        fprintf(stderr, "ras_depth must not be negative, not %d\n", depth);
+        return 1;
+    }
+    if (depth > 0) {
+        stack->entries = (uint64_t*)calloc((size_t)depth, sizeof(uint64_t));
+        if (!stack->entries) {
+            perror("Failed to allocate memory for the return address stack");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void return_stack_free(ReturnStack* stack) {
+    free(stack->entries);
+    stack->entries = NULL;
+}
+
+bool return_stack_push(ReturnStack* stack, uint64_t return_address) {
+    if (stack->depth == 0) {
+        return true;
+    }
+    stack->entries[stack->top] = return_address;
+    stack->top = (stack->top + 1) % stack->depth;
+    if (stack->count == stack->depth) {
+        return true; // The oldest entry was just overwritten
+    }
+    stack->count++;
+    return false;
+}
+
+bool return_stack_pop(ReturnStack* stack, uint64_t* return_address) {
+    if (stack->count == 0) {
+        return false;
+    }
+    stack->top = (stack->top + stack->depth - 1) % stack->depth;
+    stack->count--;
+    *return_address = stack->entries[stack->top];
+    return true;
+}
+
+int return_stack_save(const ReturnStack* stack, FILE* file) {
+    return checkpoint_write_u64(file, (uint64_t)stack->depth)
+        || checkpoint_write_u64(file, (uint64_t)stack->top)
+        || checkpoint_write_u64(file, (uint64_t)stack->count)
+        || checkpoint_write(file, stack->entries, (size_t)stack->depth * sizeof(uint64_t));
+}
+
+int return_stack_load(ReturnStack* stack, FILE* file) {
+    uint64_t top, count;
+    if (checkpoint_expect(file, (uint64_t)stack->depth, "ras_depth")
+        || checkpoint_read_u64(file, &top)
+        || checkpoint_read_u64(file, &count)
+        || checkpoint_read(file, stack->entries, (size_t)stack->depth * sizeof(uint64_t))) {
+        return 1;
+    }
+    stack->top = (int)top;
+    stack->count = (int)count;
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef RETURN_STACK_H
+#define RETURN_STACK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Return address stack of a fixed depth. Calls push the address after the call and returns pop
+// their predicted target. Like the hardware it models, the stack is a circular buffer: a push
+// onto a full stack overwrites the oldest entry, and a pop from an empty stack has no prediction.
+typedef struct {
+    uint64_t* entries;
+    int depth;
+    int top;                // Slot the next push goes to
+    int count;              // Valid entries, at most depth
+} ReturnStack;
+
+// depth 0 gives a stack that is always empty
+int return_stack_init(ReturnStack* stack, int depth);
+void return_stack_free(ReturnStack* stack);
+
+// Returns true when the push overflowed, dropping the oldest return address
+bool return_stack_push(ReturnStack* stack, uint64_t return_address);
+
+// Returns false when the stack underflowed and there is no prediction
+bool return_stack_pop(ReturnStack* stack, uint64_t* return_address);
+
+// Checkpoint the entries; loading fails unless the stack has the depth it was saved with
+int return_stack_save(const ReturnStack* stack, FILE* file);
+int return_stack_load(ReturnStack* stack, FILE* file);
+
+#endif
@@ -0,0 +1,299 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch_buffer.h"
+#include "filter_file.h"
+#include "mapped_file.h"
+#include "predictor.h"
+#include "process_stats.h"
+#include "results.h"
+#include "shards.h"
+#include "trace_decompress.h"
+#include "worker_pool.h"
+
+// Chunks warmed up on fewer branches than this get no error bound: the half-length copy would be
+// about as cold as the chunk itself, so their agreement would say nothing about the serial state
+#define MIN_BOUNDED_WARMUP 1024
+
+// One contiguous chunk of a trace and the predictors that simulated it
+typedef struct {
+    size_t begin;
+    size_t end;
+    Predictor predictors[MAX_PREDICTORS];
+    int count;
+    uint64_t divergence[MAX_PREDICTORS];    // Predictions that changed with the starting state
+    bool unbounded;                         // Warm-up too short to estimate the divergence
+} Shard;
+
+typedef struct {
+    const Config* config;
+    const BranchBuffer* buffer;
+    Shard* shards;
+} ShardedTrace;
+
+// Runs the chunk's predictors side by side with a copy that was warmed up on only half as many
+// branches, and counts the predictions on which they disagree. A warm-up long enough to make the
+// results independent of the starting state leaves the two copies in agreement, so the count
+// estimates how much the unknown serial state could still change this chunk's results.
+static void compare_with_shorter_warmup(Shard* shard, Predictor* shadow, const BranchRecord* records, size_t record_count) {
+    for (int i = 0; i < shard->count; i++) {
+        Predictor* predictor = &shard->predictors[i];
+        for (size_t r = 0; r < record_count; r++) {
+            const BranchRecord* record = &records[r];
+            bool prediction = predictor->type->predict(predictor->state, record->address);
+            bool shadow_prediction = shadow[i].type->predict(shadow[i].state, record->address);
+            predictor->type->update(predictor->state, record->address, record->taken);
+            shadow[i].type->update(shadow[i].state, record->address, record->taken);
+
+            if (prediction != shadow_prediction) shard->divergence[i]++;
+            if (prediction != record->taken) predictor->mispredictions++;
+        }
+        predictor->total_branches += record_count;
+    }
+}
+
+// Simulates records [start, end) with the ones before counted left uncounted
+static void simulate_range(const BranchRecord* records, size_t start, size_t counted, size_t end, Predictor* predictors, int count) {
+    set_warmup_branches(predictors, count, counted - start);
+    SimulateRecords(records + start, end - start, predictors, count);
+}
+
+static void shard_job(void* context, int index) {
+    ShardedTrace* trace = (ShardedTrace*)context;
+    const Config* config = trace->config;
+    Shard* shard = &trace->shards[index];
+    const BranchRecord* records = trace->buffer->records;
+
+    PredictorConfig sizing;
+    config_predictor_sizing(config, config->ghr_bits.values[0], config->bhr_bits.values[0], config->entries.values[0], &sizing);
+    shard->count = create_predictors(shard->predictors, config->which_predictor, &sizing);
+    if (shard->count == 0) {
+        return;
+    }
+
+    // Branches before the trace-wide warmup_branches are never counted, even inside the chunk
+    size_t overlap = shard->begin < config->shard_warmup ? shard->begin : (size_t)config->shard_warmup;
+    size_t counted = shard->begin;
+    if (config->warmup_branches > counted) {
+        counted = config->warmup_branches < shard->end ? (size_t)config->warmup_branches : shard->end;
+    }
+
+    // A warm-up that reaches back to the start of the trace reproduces the serial run exactly
+    if (overlap == shard->begin) {
+        simulate_range(records, 0, counted, shard->end, shard->predictors, shard->count);
+        return;
+    }
+
+    if (overlap < MIN_BOUNDED_WARMUP) {
+        shard->unbounded = true;
+        simulate_range(records, shard->begin - overlap, counted, shard->end, shard->predictors, shard->count);
+        return;
+    }
+
+    Predictor shadow[MAX_PREDICTORS];
+    if (create_predictors(shadow, config->which_predictor, &sizing) != shard->count) {
+        destroy_predictors(shard->predictors, shard->count);
+        shard->count = 0;
+        return;
+    }
+    simulate_range(records, shard->begin - overlap, counted, counted, shard->predictors, shard->count);
+    simulate_range(records, shard->begin - overlap / 2, counted, counted, shadow, shard->count);
+    compare_with_shorter_warmup(shard, shadow, records + counted, shard->end - counted);
+    destroy_predictors(shadow, shard->count);
+}
+
+static void print_error_bounds(const Config* config, const Shard* shards, const Predictor* merged, int count) {
+    printf("Sharded over %d chunks with %llu warm-up branches each; estimated error bound vs the serial run:\n",
+        config->shards, (unsigned long long)config->shard_warmup);
+    int unbounded = 0;
+    for (int s = 0; s < config->shards; s++) {
+        if (shards[s].unbounded) unbounded++;
+    }
+    for (int i = 0; i < count; i++) {
+        if (unbounded > 0) {
+            printf("  %-20s unknown (%d chunks warmed up on fewer than %d branches)\n",
+                merged[i].name, unbounded, MIN_BOUNDED_WARMUP);
+            continue;
+        }
+        uint64_t bound = 0;
+        for (int s = 0; s < config->shards; s++) bound += shards[s].divergence[i];
+        double points = merged[i].total_branches ? (double)bound / merged[i].total_branches * 100 : 0.0;
+        printf("  %-20s +/- %llu mispredictions (+/- %.4f percentage points)\n",
+            merged[i].name, (unsigned long long)bound, points);
+    }
+}
+
+// Rows carry the trace-wide warm-up next to the sharding
+static void write_results(const Config* config, ResultsSink* results, const char* trace, const Predictor* merged, int count) {
+    PredictorConfig sizing;
+    config_predictor_sizing(config, config->ghr_bits.values[0], config->bhr_bits.values[0], config->entries.values[0], &sizing);
+    for (int i = 0; i < count; i++) {
+        ResultRow row;
+        result_row_from_predictor(&row, trace, &merged[i], &sizing, config->warmup_branches);
+        row.shards = config->shards;
+        row.shard_warmup = config->shard_warmup;
+        results_write(results, &row);
+    }
+}
+
+static int run_sharded_trace(const Config* config, ResultsSink* results, const char* trace, const BranchBuffer* buffer) {
+    Shard* shards = (Shard*)calloc(config->shards, sizeof(Shard));
+    if (!shards) {
+        perror("Failed to allocate memory for shards");
+        return 1;
+    }
+    for (int s = 0; s < config->shards; s++) {
+        shards[s].begin = buffer->count * s / config->shards;
+        shards[s].end = buffer->count * (s + 1) / config->shards;
+    }
+
+    // The chunks run in parallel, so every predictor is credited with the wall time of them all
+    // rather than the sum of the per-chunk times
+    ShardedTrace sharded = { config, buffer, shards };
+    double start = monotonic_seconds();
+    run_jobs(shard_job, &sharded, config->shards, config->threads);
+    double seconds = monotonic_seconds() - start;
+
+    // Chunk 0 keeps its predictors to carry the merged counts; the others only contribute counts
+    int result = 0;
+    Predictor* merged = shards[0].predictors;
+    int count = shards[0].count;
+    for (int s = 0; s < config->shards; s++) {
+        if (shards[s].count != count || count == 0) {
+            result = 1;
+        }
+        if (s > 0) {
+            for (int i = 0; i < count && i < shards[s].count; i++) {
+                merged[i].total_branches += shards[s].predictors[i].total_branches;
+                merged[i].mispredictions += shards[s].predictors[i].mispredictions;
+            }
+            destroy_predictors(shards[s].predictors, shards[s].count);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        merged[i].seconds = seconds;
+    }
+    if (result == 0) {
+        PrintResults(trace, merged, count);
+        print_error_bounds(config, shards, merged, count);
+        if (results) {
+            write_results(config, results, trace, merged, count);
+        }
+    }
+    destroy_predictors(merged, count);
+    free(shards);
+    return result;
+}
+
+// One line-aligned byte range of a plain trace, filtered on its own
+typedef struct {
+    const char* begin;
+    const char* end;
+    BranchBuffer records;
+    int result;
+} TracePart;
+
+typedef struct {
+    const char* trace_end;
+    TracePart* parts;
+} SplitTrace;
+
+static void filter_part_job(void* context, int index) {
+    SplitTrace* split = (SplitTrace*)context;
+    TracePart* part = &split->parts[index];
+    BranchSink records = branch_buffer_conditional_sink(&part->records);
+    part->result = filterBranchRange(part->begin, part->end, split->trace_end, &records);
+}
+
+// Start of the first line at or after position
+static const char* line_start(const char* data, const char* position, const char* end) {
+    if (position == data) {
+        return position;
+    }
+    const char* newline = (const char*)memchr(position - 1, '\n', end - position + 1);
+    return newline ? newline + 1 : end;
+}
+
+// Decodes the conditional branches of a trace into buffer. Filtering the text dominates a sharded
+// run, so a plain trace is cut into one range per shard at line boundaries and the ranges are
+// filtered in parallel, then joined in order. A compressed trace is one sequential stream and is
+// filtered serially.
+static int decode_trace(const Config* config, const char* path, BranchBuffer* buffer) {
+    MappedFile file;
+    if (map_file(&file, path)) {
+        return 1;
+    }
+    if (trace_compression(file.data, file.size) != TRACE_PLAIN) {
+        unmap_file(&file);
+        BranchSink records = branch_buffer_conditional_sink(buffer);
+        return filterBranchRecords(path, &records);
+    }
+
+    TracePart* parts = (TracePart*)calloc(config->shards, sizeof(TracePart));
+    if (!parts) {
+        perror("Failed to allocate memory for trace parts");
+        unmap_file(&file);
+        return 1;
+    }
+    const char* end = file.data + file.size;
+    for (int p = 0; p < config->shards; p++) {
+        parts[p].begin = line_start(file.data, file.data + file.size * p / config->shards, end);
+        parts[p].end = line_start(file.data, file.data + file.size * (p + 1) / config->shards, end);
+        branch_buffer_init(&parts[p].records);
+    }
+
+    SplitTrace split = { end, parts };
+    run_jobs(filter_part_job, &split, config->shards, config->threads);
+
+    int result = 0;
+    for (int p = 0; p < config->shards; p++) {
+        if (result == 0 && (parts[p].result != 0 || branch_buffer_append_buffer(buffer, &parts[p].records))) {
+            result = 1;
+        }
+        branch_buffer_free(&parts[p].records);
+    }
+    free(parts);
+    unmap_file(&file);
+    return result;
+}
+
+int RunSharded(const Config* config, const char* const* traces, int trace_count) {
+    int result = 0;
+    ResultsSink results_file;
+    ResultsSink* results = NULL;
+    if (config->results_output[0] != '\0') {
+        if (results_open(&results_file, config->results_output)) {
+            return 1;
+        }
+        results = &results_file;
+    }
+
+    for (int t = 0; t < trace_count; t++) {
+        BranchBuffer buffer;
+        branch_buffer_init(&buffer);
+
+        if (decode_trace(config, traces[t], &buffer) != 0) {
+            fprintf(stderr, "Failed to decode %s\n", traces[t]);
+            result = 1;
+        }
+        else if (run_sharded_trace(config, results, traces[t], &buffer)) {
+            result = 1;
+        }
+        branch_buffer_free(&buffer);
+    }
+
+    if (results) {
+        if (results_close(results)) {
+            fprintf(stderr, "Failed to write %s\n", config->results_output);
+            result = 1;
+        }
+        else {
+            printf("Results have been written to %s\n", config->results_output);
+        }
+    }
+    return result;
+}
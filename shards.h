@@ -0,0 +1,15 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include "config.h"
+
+// Approximate simulation of long traces: each trace is decoded once into memory (in parallel for
+// plain traces, see decode_trace) and split into config->shards contiguous chunks that are
+// simulated in parallel by independent predictors.
+// Every chunk first replays up to config->shard_warmup preceding branches, uncounted, so its
+// predictors start warm; the per-chunk counts are then summed. Chunks whose warm-up reaches back
+// to the start of the trace are exact. The others may differ from the serial run, so the report
+// includes an estimated error bound per predictor.
+int RunSharded(const Config* config, const char* const* traces, int trace_count);
+
+#endif
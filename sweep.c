@@ -0,0 +1,156 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "branch_buffer.h"
+#include "filter_file.h"
+#include "predictor.h"
+#include "results.h"
+#include "sweep.h"
+#include "worker_pool.h"
+
+// One configuration simulated over one trace
+typedef struct {
+    int trace;
+    int ghr_bits;
+    int bhr_bits;
+    int entries;
+    PredictorConfig sizing;
+    bool failed;                // The predictors could not be created for this configuration
+    int count;
+    ResultRow rows[MAX_PREDICTORS];
+} SweepPoint;
+
+typedef struct {
+    const Config* config;
+    const char* const* traces;
+    BranchBuffer* buffers;
+    int* decode_results;
+    SweepPoint* points;
+} Sweep;
+
+static void decode_trace_job(void* context, int index) {
+    Sweep* sweep = (Sweep*)context;
+    BranchSink sink = branch_buffer_conditional_sink(&sweep->buffers[index]);
+    sweep->decode_results[index] = filterBranchRecords(sweep->traces[index], &sink);
+}
+
+static void sweep_point_job(void* context, int index) {
+    Sweep* sweep = (Sweep*)context;
+    SweepPoint* point = &sweep->points[index];
+    const BranchBuffer* buffer = &sweep->buffers[point->trace];
+
+    point->count = 0;
+    if (sweep->decode_results[point->trace] != 0) {
+        return;
+    }
+
+    Predictor predictors[MAX_PREDICTORS];
+    config_predictor_sizing(sweep->config, point->ghr_bits, point->bhr_bits, point->entries, &point->sizing);
+    int count = create_predictors(predictors, sweep->config->which_predictor, &point->sizing);
+    if (count == 0) {
+        point->failed = true;
+        return;
+    }
+    set_warmup_branches(predictors, count, sweep->config->warmup_branches);
+    SimulateRecords(buffer->records, buffer->count, predictors, count);
+
+    for (int i = 0; i < count; i++) {
+        result_row_from_predictor(&point->rows[i], sweep->traces[point->trace], &predictors[i], &point->sizing,
+            sweep->config->warmup_branches);
+    }
+    point->count = count;
+    destroy_predictors(predictors, count);
+}
+
+int RunSweep(const Config* config, const char* const* traces, int trace_count) {
+    const ParameterValues* ghr = &config->ghr_bits;
+    const ParameterValues* bhr = &config->bhr_bits;
+    const ParameterValues* entries = &config->entries;
+    int ghr_count = ghr->count ? ghr->count : 1;
+    int bhr_count = bhr->count ? bhr->count : 1;
+    int entries_count = entries->count ? entries->count : 1;
+    int combinations = ghr_count * bhr_count * entries_count;
+    int point_count = trace_count * combinations;
+
+    Sweep sweep;
+    sweep.config = config;
+    sweep.traces = traces;
+    sweep.buffers = (BranchBuffer*)malloc(trace_count * sizeof(BranchBuffer));
+    sweep.decode_results = (int*)malloc(trace_count * sizeof(int));
+    sweep.points = (SweepPoint*)malloc(point_count * sizeof(SweepPoint));
+    if (!sweep.buffers || !sweep.decode_results || !sweep.points) {
+        perror("Failed to allocate memory for sweep");
+        free(sweep.buffers);
+        free(sweep.decode_results);
+        free(sweep.points);
+        return 1;
+    }
+
+    // Decode every trace once; all configurations replay the same records
+    for (int t = 0; t < trace_count; t++) {
+        branch_buffer_init(&sweep.buffers[t]);
+    }
+    run_jobs(decode_trace_job, &sweep, trace_count, config->threads);
+
+    int p = 0;
+    for (int t = 0; t < trace_count; t++) {
+        for (int g = 0; g < ghr_count; g++) {
+            for (int b = 0; b < bhr_count; b++) {
+                for (int e = 0; e < entries_count; e++) {
+                    SweepPoint* point = &sweep.points[p++];
+                    point->trace = t;
+                    point->ghr_bits = ghr->values[g];
+                    point->bhr_bits = bhr->values[b];
+                    point->entries = entries->values[e];
+                    point->failed = false;
+                }
+            }
+        }
+    }
+    run_jobs(sweep_point_job, &sweep, point_count, config->threads);
+
+    int result = 0;
+    for (int t = 0; t < trace_count; t++) {
+        if (sweep.decode_results[t] != 0) {
+            fprintf(stderr, "Failed to decode %s, it is missing from the sweep\n", traces[t]);
+            result = 1;
+        }
+        branch_buffer_free(&sweep.buffers[t]);
+    }
+    for (int p = 0; p < point_count; p++) {
+        const SweepPoint* point = &sweep.points[p];
+        if (point->failed) {
+            fprintf(stderr, "Failed to create the predictors for ghr_bits = %d, bhr_bits = %d, entries = %d on %s, "
+                "it is missing from the sweep\n", point->ghr_bits, point->bhr_bits, point->entries, traces[point->trace]);
+            result = 1;
+        }
+    }
+
+    // The table goes to stdout when the file cannot be created, so the sweep is not lost
+    ResultsSink sink;
+    bool to_file = config->sweep_output[0] != '\0';
+    if (results_open(&sink, config->sweep_output)) {
+        results_open(&sink, "");
+        to_file = false;
+        result = 1;
+    }
+    for (int p = 0; p < point_count; p++) {
+        for (int i = 0; i < sweep.points[p].count; i++) {
+            results_write(&sink, &sweep.points[p].rows[i]);
+        }
+    }
+    if (results_close(&sink)) {
+        fprintf(stderr, "Failed to write the sweep results\n");
+        result = 1;
+    }
+    else if (to_file) {
+        printf("Sweep results for %d configurations have been written to %s\n", combinations, config->sweep_output);
+    }
+
+    free(sweep.buffers);
+    free(sweep.decode_results);
+    free(sweep.points);
+    return result;
+}
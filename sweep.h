@@ -0,0 +1,11 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "config.h"
+
+// Runs every (ghr_bits, bhr_bits, entries) combination of the configuration over each trace.
+// Each trace is filtered and decoded once into memory and shared by all combinations; the
+// misprediction table is written as CSV or JSON (see Config::sweep_output).
+int RunSweep(const Config* config, const char* const* traces, int trace_count);
+
+#endif
@@ -0,0 +1,137 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "synthetic_trace.h"
+
+#define SYNTHETIC_BASE_ADDRESS 0x80000000ULL
+#define LOOP_COUNT 8
+#define MAX_LOOP_TRIPS 32
+#define CORRELATED_GROUPS 64
+#define RANDOM_BRANCHES 4096
+#define LARGE_FOOTPRINT_BRANCHES (1 << 20)
+
+static const char* pattern_names[SYNTHETIC_PATTERN_COUNT] = { "loops", "correlated", "random", "large_footprint" };
+
+const char* synthetic_pattern_name(SyntheticPattern pattern) {
+    return pattern_names[pattern];
+}
+
+// xorshift64*, seeded so that no seed gives the all-zero state
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// True with probability taken_per_mille / 1000
+static bool biased_outcome(uint64_t* state, uint32_t taken_per_mille) {
+    return (uint32_t)(next_random(state) % 1000) < taken_per_mille;
+}
+
+typedef struct {
+    BranchBuffer* records;
+    size_t remaining;
+    int failed;
+} Emitter;
+
+static bool emit(Emitter* emitter, uint64_t address, bool taken) {
+    if (emitter->remaining == 0 || emitter->failed) {
+        return false;
+    }
+    BranchRecord record;
+    record.address = address;
+    record.target = taken ? address - 64 : address + 4; // Taken branches jump a fixed distance back
+    record.taken = taken;
+    record.compressed = false;
+    record.kind = BRANCH_CONDITIONAL;
+    if (branch_buffer_append(emitter->records, &record)) {
+        emitter->failed = 1;
+        return false;
+    }
+    emitter->remaining--;
+    return true;
+}
+
+static void generate_loops(Emitter* emitter, uint64_t* state) {
+    int trips[LOOP_COUNT];
+    for (int i = 0; i < LOOP_COUNT; i++) {
+        trips[i] = 2 + (int)(next_random(state) % (MAX_LOOP_TRIPS - 1));
+    }
+
+    // An outer loop whose body runs each inner loop to completion
+    uint64_t outer = SYNTHETIC_BASE_ADDRESS + 4 * (LOOP_COUNT + 1);
+    for (;;) {
+        for (int i = 0; i < LOOP_COUNT; i++) {
+            uint64_t address = SYNTHETIC_BASE_ADDRESS + 4 * (uint64_t)i;
+            for (int trip = 1; trip <= trips[i]; trip++) {
+                if (!emit(emitter, address, trip < trips[i])) return;
+            }
+        }
+        if (!emit(emitter, outer, true)) return;
+    }
+}
+
+static void generate_correlated(Emitter* emitter, uint64_t* state) {
+    for (;;) {
+        // Four branches per group: two independent coin flips, their XOR and a repeat of the first
+        uint64_t address = SYNTHETIC_BASE_ADDRESS + 16 * (next_random(state) % CORRELATED_GROUPS);
+        bool first = next_random(state) & 1;
+        bool second = next_random(state) & 1;
+        if (!emit(emitter, address, first)
+            || !emit(emitter, address + 4, second)
+            || !emit(emitter, address + 8, first ^ second)
+            || !emit(emitter, address + 12, first)) {
+            return;
+        }
+    }
+}
+
+static void generate_random(Emitter* emitter, uint64_t* state) {
+    uint32_t bias[RANDOM_BRANCHES];
+    for (int i = 0; i < RANDOM_BRANCHES; i++) {
+        bias[i] = (uint32_t)(next_random(state) % 1001);
+    }
+
+    for (;;) {
+        size_t branch = (size_t)(next_random(state) % RANDOM_BRANCHES);
+        if (!emit(emitter, SYNTHETIC_BASE_ADDRESS + 4 * (uint64_t)branch, biased_outcome(state, bias[branch]))) return;
+    }
+}
+
+static void generate_large_footprint(Emitter* emitter, uint64_t* state) {
+    for (;;) {
+        uint64_t branch = next_random(state) % LARGE_FOOTPRINT_BRANCHES;
+
+        // Each branch leans 90% one way, the direction fixed by a hash of its index
+        bool leans_taken = ((branch * 0x9E3779B97F4A7C15ULL) >> 63) != 0;
+        bool taken = biased_outcome(state, leans_taken ? 900 : 100);
+        if (!emit(emitter, SYNTHETIC_BASE_ADDRESS + 4 * branch, taken)) return;
+    }
+}
+
+int synthetic_generate(SyntheticPattern pattern, size_t count, uint64_t seed, BranchBuffer* records) {
+    Emitter emitter;
+    emitter.records = records;
+    emitter.remaining = count;
+    emitter.failed = 0;
+    records->count = 0;
+
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    if (state == 0) state = 1;
+
+    switch (pattern) {
+        case SYNTHETIC_LOOPS: generate_loops(&emitter, &state); break;
+        case SYNTHETIC_CORRELATED: generate_correlated(&emitter, &state); break;
+        case SYNTHETIC_RANDOM: generate_random(&emitter, &state); break;
+        case SYNTHETIC_LARGE_FOOTPRINT: generate_large_footprint(&emitter, &state); break;
+        default:
+            fprintf(stderr, "Unknown synthetic pattern: %d\n", (int)pattern);
+            return 1;
+    }
+    return emitter.failed;
+}
@@ -0,0 +1,23 @@
+#ifndef SYNTHETIC_TRACE_H
+#define SYNTHETIC_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "branch_buffer.h"
+
+// Deterministic synthetic branch streams for benchmarking the simulator itself. The same pattern,
+// count and seed always give the same records, so timings are comparable between builds.
+typedef enum {
+    SYNTHETIC_LOOPS = 0,        // Nested counted loops: long taken runs ended by one not-taken exit
+    SYNTHETIC_CORRELATED,       // Branches whose outcome is the XOR of earlier branches' outcomes
+    SYNTHETIC_RANDOM,           // A few thousand branches with random biases, outcomes drawn per execution
+    SYNTHETIC_LARGE_FOOTPRINT,  // A million distinct mostly-biased branches that overflow any BTB
+    SYNTHETIC_PATTERN_COUNT
+} SyntheticPattern;
+
+const char* synthetic_pattern_name(SyntheticPattern pattern);
+
+// Replaces the contents of records with count branches of the pattern; returns 0 on success
+int synthetic_generate(SyntheticPattern pattern, size_t count, uint64_t seed, BranchBuffer* records);
+
+#endif
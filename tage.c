@@ -0,0 +1,280 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "checkpoint.h"
+#include "counter_table.h"
+#include "history.h"
+#include "predictor.h"
+
+// TAGE-lite: a bimodal base table backed by tagged tables indexed with geometrically longer
+// global histories. The longest matching table provides the prediction; mispredictions allocate
+// entries in longer tables. Sizes are fixed, roughly an 8 KiB budget.
+
+#define TAGE_TABLES 4
+#define TAGE_TABLE_BITS 10
+#define TAGE_TAG_BITS 9
+#define TAGE_TAG_VALID 0x8000       // Set in the tag of every allocated entry, so a zeroed entry never matches
+#define TAGE_BASE_BITS 12
+#define TAGE_COUNTER_MAX 3          // Signed 3-bit prediction counters, taken when >= 0
+#define TAGE_COUNTER_MIN -4
+#define TAGE_USEFUL_MAX 3           // 2-bit usefulness counters
+#define TAGE_USE_ALT_MAX 7          // 4-bit signed "use the alternate prediction on new entries" counter
+#define TAGE_USE_ALT_MIN -8
+#define TAGE_USEFUL_RESET_PERIOD (1u << 18)
+
+static const int history_lengths[TAGE_TABLES] = { 5, 15, 44, 130 };
+
+typedef struct {
+    int8_t counter;
+    uint8_t useful;
+    uint16_t tag;           // TAGE_TAG_BITS of tag plus TAGE_TAG_VALID
+} TageEntry;
+
+typedef struct {
+    CounterTable base;                          // Bimodal 2-bit counters indexed by the address
+    TageEntry* tables[TAGE_TABLES];
+    GlobalHistory history;
+    FoldedHistory index_history[TAGE_TABLES];
+    FoldedHistory tag_history[TAGE_TABLES][2];  // Two foldings of different widths spread the tag bits
+    int use_alt_on_new;
+    uint32_t branch_count;
+
+    // Lookup of the branch being predicted, reused by the update
+    uint32_t indices[TAGE_TABLES];
+    uint16_t tags[TAGE_TABLES];
+    uint64_t base_index;
+    int provider;                               // Longest matching table, -1 when only the base matched
+    bool provider_prediction;
+    bool alt_prediction;
+    bool new_entry;                             // Provider is weak and has never been useful
+} TagePredictor;
+
+static void saturating_add(int8_t* counter, int delta, int min, int max) {
+    int value = *counter + delta;
+    *counter = (int8_t)(value < min ? min : value > max ? max : value);
+}
+
+static void compute_lookup(TagePredictor* predictor, uint64_t branch_address) {
+    uint64_t pc = branch_address >> 1; // Instructions are at least 2-byte aligned
+    uint32_t index_mask = (1u << TAGE_TABLE_BITS) - 1;
+
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        predictor->indices[i] = (uint32_t)(pc ^ (pc >> (TAGE_TABLE_BITS - i)) ^ predictor->index_history[i].value) & index_mask;
+        predictor->tags[i] = (uint16_t)(((pc ^ predictor->tag_history[i][0].value ^ (predictor->tag_history[i][1].value << 1))
+            & ((1u << TAGE_TAG_BITS) - 1)) | TAGE_TAG_VALID);
+    }
+    predictor->base_index = pc & ((1u << TAGE_BASE_BITS) - 1);
+}
+
+static bool tage_predict(void* state, uint64_t branch_address) {
+    TagePredictor* predictor = (TagePredictor*)state;
+    compute_lookup(predictor, branch_address);
+
+    int provider = -1;
+    int alternate = -1;
+    for (int i = TAGE_TABLES - 1; i >= 0; i--) {
+        if (predictor->tables[i][predictor->indices[i]].tag == predictor->tags[i]) {
+            if (provider < 0) {
+                provider = i;
+            }
+            else {
+                alternate = i;
+                break;
+            }
+        }
+    }
+
+    bool base_prediction = counter_table_predict(&predictor->base, predictor->base_index);
+    predictor->provider = provider;
+    predictor->alt_prediction = alternate >= 0
+        ? predictor->tables[alternate][predictor->indices[alternate]].counter >= 0
+        : base_prediction;
+
+    if (provider < 0) {
+        predictor->provider_prediction = base_prediction;
+        predictor->new_entry = false;
+        return base_prediction;
+    }
+
+    const TageEntry* entry = &predictor->tables[provider][predictor->indices[provider]];
+    predictor->provider_prediction = entry->counter >= 0;
+    predictor->new_entry = (entry->counter == 0 || entry->counter == -1) && entry->useful == 0;
+
+    // A freshly allocated entry is often worse than the alternate prediction
+    if (predictor->new_entry && predictor->use_alt_on_new >= 0) {
+        return predictor->alt_prediction;
+    }
+    return predictor->provider_prediction;
+}
+
+static void allocate_entry(TagePredictor* predictor, bool taken) {
+    for (int i = predictor->provider + 1; i < TAGE_TABLES; i++) {
+        TageEntry* entry = &predictor->tables[i][predictor->indices[i]];
+        if (entry->useful == 0) {
+            entry->tag = predictor->tags[i];
+            entry->counter = taken ? 0 : -1;
+            return;
+        }
+    }
+
+    // Every candidate is still useful: age them so a later allocation succeeds
+    for (int i = predictor->provider + 1; i < TAGE_TABLES; i++) {
+        TageEntry* entry = &predictor->tables[i][predictor->indices[i]];
+        if (entry->useful > 0) entry->useful--;
+    }
+}
+
+static void tage_update(void* state, uint64_t branch_address, bool taken) {
+    TagePredictor* predictor = (TagePredictor*)state;
+    int provider = predictor->provider;
+
+    if (provider >= 0) {
+        TageEntry* entry = &predictor->tables[provider][predictor->indices[provider]];
+
+        if (predictor->new_entry && predictor->provider_prediction != predictor->alt_prediction) {
+            int8_t use_alt = (int8_t)predictor->use_alt_on_new;
+            saturating_add(&use_alt, predictor->alt_prediction == taken ? 1 : -1, TAGE_USE_ALT_MIN, TAGE_USE_ALT_MAX);
+            predictor->use_alt_on_new = use_alt;
+        }
+
+        saturating_add(&entry->counter, taken ? 1 : -1, TAGE_COUNTER_MIN, TAGE_COUNTER_MAX);
+
+        // An entry is useful when it was right where the shorter history was wrong
+        if (predictor->provider_prediction != predictor->alt_prediction) {
+            if (predictor->provider_prediction == taken) {
+                if (entry->useful < TAGE_USEFUL_MAX) entry->useful++;
+            }
+            else {
+                if (entry->useful > 0) entry->useful--;
+            }
+        }
+    }
+    else {
+        counter_table_update(&predictor->base, predictor->base_index, taken);
+    }
+
+    if (predictor->provider_prediction != taken && provider < TAGE_TABLES - 1) {
+        allocate_entry(predictor, taken);
+    }
+
+    // Periodically halve every usefulness counter so stale entries can be replaced
+    if (++predictor->branch_count % TAGE_USEFUL_RESET_PERIOD == 0) {
+        for (int i = 0; i < TAGE_TABLES; i++) {
+            for (int e = 0; e < (1 << TAGE_TABLE_BITS); e++) {
+                predictor->tables[i][e].useful >>= 1;
+            }
+        }
+    }
+
+    history_push(&predictor->history, taken);
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        folded_history_update(&predictor->index_history[i], &predictor->history);
+        folded_history_update(&predictor->tag_history[i][0], &predictor->history);
+        folded_history_update(&predictor->tag_history[i][1], &predictor->history);
+    }
+}
+
+static void tage_stats(const void* state, PredictorStats* stats) {
+    const TagePredictor* predictor = (const TagePredictor*)state;
+    uint64_t entry_bits = 3 + 2 + TAGE_TAG_BITS + 1;
+    stats->storage_bits = 2 * (uint64_t)predictor->base.size
+        + TAGE_TABLES * ((uint64_t)1 << TAGE_TABLE_BITS) * entry_bits
+        + history_lengths[TAGE_TABLES - 1] + 4;
+    stats->memory_bytes = counter_table_bytes(&predictor->base) + TAGE_TABLES * (sizeof(TageEntry) << TAGE_TABLE_BITS);
+}
+
+static void tage_destroy(void* state) {
+    TagePredictor* predictor = (TagePredictor*)state;
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        free(predictor->tables[i]);
+    }
+    history_free(&predictor->history);
+    counter_table_free(&predictor->base);
+    free(predictor);
+}
+
+static int tage_save(const void* state, FILE* file) {
+    const TagePredictor* predictor = (const TagePredictor*)state;
+    if (counter_table_save(&predictor->base, file) || history_save(&predictor->history, file)
+        || checkpoint_write_u64(file, (uint64_t)(int64_t)predictor->use_alt_on_new)
+        || checkpoint_write_u64(file, predictor->branch_count)) {
+        return 1;
+    }
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        if (checkpoint_write(file, predictor->tables[i], sizeof(TageEntry) << TAGE_TABLE_BITS)
+            || folded_history_save(&predictor->index_history[i], file)
+            || folded_history_save(&predictor->tag_history[i][0], file)
+            || folded_history_save(&predictor->tag_history[i][1], file)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int tage_load(void* state, FILE* file) {
+    TagePredictor* predictor = (TagePredictor*)state;
+    uint64_t use_alt_on_new, branch_count;
+    if (counter_table_load(&predictor->base, file) || history_load(&predictor->history, file)
+        || checkpoint_read_u64(file, &use_alt_on_new)
+        || checkpoint_read_u64(file, &branch_count)) {
+        return 1;
+    }
+    predictor->use_alt_on_new = (int)(int64_t)use_alt_on_new;
+    predictor->branch_count = (uint32_t)branch_count;
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        if (checkpoint_read(file, predictor->tables[i], sizeof(TageEntry) << TAGE_TABLE_BITS)
+            || folded_history_load(&predictor->index_history[i], file)
+            || folded_history_load(&predictor->tag_history[i][0], file)
+            || folded_history_load(&predictor->tag_history[i][1], file)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int tage_init(void** predictor_state, const PredictorConfig* config) {
+    TagePredictor* state = (TagePredictor*)calloc(1, sizeof(TagePredictor));
+    if (!state) {
+        perror("Failed to allocate memory for TAGE predictor");
+        return 1;
+    }
+
+    if (counter_table_init(&state->base, (size_t)1 << TAGE_BASE_BITS)
+        || history_init(&state->history, history_lengths[TAGE_TABLES - 1])) {
+        tage_destroy(state);
+        return 1;
+    }
+
+    for (int i = 0; i < TAGE_TABLES; i++) {
+        // Entries start invalid and only match once allocate_entry has written their tag
+        state->tables[i] = (TageEntry*)calloc((size_t)1 << TAGE_TABLE_BITS, sizeof(TageEntry));
+        if (!state->tables[i]) {
+            perror("Failed to allocate memory for TAGE tables");
+            tage_destroy(state);
+            return 1;
+        }
+        folded_history_init(&state->index_history[i], history_lengths[i], TAGE_TABLE_BITS);
+        folded_history_init(&state->tag_history[i][0], history_lengths[i], TAGE_TAG_BITS);
+        folded_history_init(&state->tag_history[i][1], history_lengths[i], TAGE_TAG_BITS - 1);
+    }
+
+    *predictor_state = state;
+    return 0;
+}
+
+const PredictorType tage_predictor = {
+    "TAGE",
+    tage_init,
+    tage_predict,
+    tage_update,
+    tage_stats,
+    tage_destroy,
+    tage_save,
+    tage_load,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+};
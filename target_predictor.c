@@ -0,0 +1,209 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "checkpoint.h"
+#include "target_predictor.h"
+
+#define PATH_HISTORY_SHIFT 2    // Bits each taken target shifts the path history by
+
+static uint64_t indirect_mask(const TargetPredictor* predictor) {
+    return ((uint64_t)1 << predictor->indirect_bits) - 1;
+}
+
+static void push_path(TargetPredictor* predictor, uint64_t target) {
+    predictor->path_history = ((predictor->path_history << PATH_HISTORY_SHIFT) ^ (target >> 1)) & indirect_mask(predictor);
+}
+
+TargetPredictor* target_predictor_create(BTB* btb, int btb_entries, int ways, BTBReplacement replacement,
+    int indirect_bits, int ras_depth) {
+    if (indirect_bits < 1 || indirect_bits > 24) {
+        fprintf(stderr, "indirect_bits must be between 1 and 24, not %d\n", indirect_bits);
+        return NULL;
+    }
+
+    TargetPredictor* predictor = (TargetPredictor*)calloc(1, sizeof(TargetPredictor));
+    if (!predictor) {
+        perror("Failed to allocate memory for target predictor");
+        return NULL;
+    }
+
+    predictor->indirect_bits = indirect_bits;
+    predictor->indirect = (IndirectTarget*)calloc((size_t)1 << indirect_bits, sizeof(IndirectTarget));
+    if (!predictor->indirect) {
+        perror("Failed to allocate memory for the indirect target cache");
+        free(predictor);
+        return NULL;
+    }
+    if (return_stack_init(&predictor->returns, ras_depth)) {
+        free(predictor->indirect);
+        free(predictor);
+        return NULL;
+    }
+
+    predictor->shared = btb != NULL;
+    predictor->btb = btb;
+    if (!predictor->shared) {
+        if (btb_init(&predictor->own_btb, btb_entries, ways, replacement, 0, true)) {
+            return_stack_free(&predictor->returns);
+            free(predictor->indirect);
+            free(predictor);
+            return NULL;
+        }
+        predictor->btb = &predictor->own_btb;
+    }
+    return predictor;
+}
+
+void target_predictor_destroy(TargetPredictor* predictor) {
+    if (!predictor) {
+        return;
+    }
+    if (!predictor->shared) {
+        btb_free(&predictor->own_btb);
+    }
+    return_stack_free(&predictor->returns);
+    free(predictor->indirect);
+    free(predictor);
+}
+
+void target_predictor_lookup(TargetPredictor* predictor, uint64_t address) {
+    BTB* btb = predictor->btb;
+    BTBSet* set = btb_set(btb, address);
+    int way = btb_find(btb, set, btb_tag(btb, address));
+    predictor->predicted_target = way >= 0 ? *btb_target(btb, set, way) : 0;
+    predictor->target_known = predictor->predicted_target != 0;
+}
+
+// A shared BTB holds what its direction predictor allocated; the own BTB allocates taken branches
+static void record_target(TargetPredictor* predictor, uint64_t address, uint64_t target) {
+    BTB* btb = predictor->btb;
+    BTBSet* set = btb_set(btb, address);
+    uint64_t tag = btb_tag(btb, address);
+    int way = btb_find(btb, set, tag);
+    if (way < 0) {
+        if (predictor->shared) {
+            return;
+        }
+        way = btb_replace(btb, set, tag);
+    }
+    else if (!predictor->shared) {
+        btb_touch(btb, set, way);
+    }
+    *btb_target(btb, set, way) = target;
+}
+
+void target_predictor_update(TargetPredictor* predictor, const BranchRecord* record, bool predicted_taken, bool counted) {
+    if (!record->taken) {
+        return;
+    }
+
+    if (counted && predicted_taken && (!predictor->target_known || predictor->predicted_target != record->target)) {
+        predictor->target_mispredictions++;
+    }
+    record_target(predictor, record->address, record->target);
+    push_path(predictor, record->target);
+}
+
+// Predicts from the indirect target cache and trains it; returns true on a misprediction
+static bool indirect_target(TargetPredictor* predictor, uint64_t address, uint64_t target) {
+    IndirectTarget* entry = &predictor->indirect[((address >> 1) ^ predictor->path_history) & indirect_mask(predictor)];
+    bool mispredicted = !entry->valid || entry->tag != address || entry->target != target;
+
+    entry->valid = true;
+    entry->tag = address;
+    entry->target = target;
+    return mispredicted;
+}
+
+static bool predict_return(TargetPredictor* predictor, const BranchRecord* record, bool counted) {
+    if (predictor->returns.depth == 0) {
+        return indirect_target(predictor, record->address, record->target);
+    }
+
+    uint64_t predicted;
+    if (!return_stack_pop(&predictor->returns, &predicted)) {
+        predictor->stack_underflows += counted;
+        return true;
+    }
+    return predicted != record->target;
+}
+
+void target_predictor_jump(TargetPredictor* predictor, const BranchRecord* record, bool counted) {
+    bool mispredicted = false;
+    switch (record->kind) {
+        case BRANCH_INDIRECT:
+        case BRANCH_INDIRECT_CALL:
+            mispredicted = indirect_target(predictor, record->address, record->target);
+            if (counted) {
+                predictor->indirect_branches++;
+                predictor->indirect_mispredictions += mispredicted;
+            }
+            break;
+        case BRANCH_RETURN:
+            mispredicted = predict_return(predictor, record, counted);
+            if (counted) {
+                predictor->return_count++;
+                predictor->return_mispredictions += mispredicted;
+            }
+            break;
+        case BRANCH_JUMP:
+        case BRANCH_CALL:
+            break;
+        default:
+            return;
+    }
+
+    if (record->kind == BRANCH_CALL || record->kind == BRANCH_INDIRECT_CALL) {
+        uint64_t return_address = record->address + (record->compressed ? 2 : 4);
+        bool overflowed = predictor->returns.depth > 0 && return_stack_push(&predictor->returns, return_address);
+        if (counted) {
+            predictor->calls++;
+            predictor->stack_overflows += overflowed;
+        }
+    }
+    push_path(predictor, record->target);
+}
+
+uint64_t target_predictor_mispredictions(const TargetPredictor* predictor) {
+    return predictor->target_mispredictions + predictor->indirect_mispredictions + predictor->return_mispredictions;
+}
+
+uint64_t target_predictor_storage_bits(const TargetPredictor* predictor) {
+    // Indirect entries hold a tag above the index, a valid bit and a full target address
+    uint64_t indirect_entry_bits = (uint64_t)(64 - predictor->indirect_bits) + 1 + 64;
+    uint64_t bits = (indirect_entry_bits << predictor->indirect_bits) + predictor->indirect_bits
+        + 64 * (uint64_t)predictor->returns.depth;
+    if (!predictor->shared) {
+        bits += btb_storage_bits(&predictor->own_btb, 0);
+    }
+    return bits;
+}
+
+uint64_t target_predictor_memory_bytes(const TargetPredictor* predictor) {
+    uint64_t bytes = (sizeof(IndirectTarget) << predictor->indirect_bits) + sizeof(uint64_t) * (uint64_t)predictor->returns.depth;
+    return predictor->shared ? bytes : bytes + btb_memory_bytes(&predictor->own_btb);
+}
+
+int target_predictor_save(const TargetPredictor* predictor, FILE* file) {
+    if (checkpoint_write_u64(file, (uint64_t)predictor->indirect_bits)
+        || checkpoint_write_u64(file, predictor->shared ? 1 : 0)
+        || checkpoint_write_u64(file, predictor->path_history)
+        || checkpoint_write(file, predictor->indirect, sizeof(IndirectTarget) << predictor->indirect_bits)
+        || return_stack_save(&predictor->returns, file)) {
+        return 1;
+    }
+    return predictor->shared ? 0 : btb_save(&predictor->own_btb, file);
+}
+
+int target_predictor_load(TargetPredictor* predictor, FILE* file) {
+    if (checkpoint_expect(file, (uint64_t)predictor->indirect_bits, "indirect_bits")
+        || checkpoint_expect(file, predictor->shared ? 1 : 0, "shared target BTB")
+        || checkpoint_read_u64(file, &predictor->path_history)
+        || checkpoint_read(file, predictor->indirect, sizeof(IndirectTarget) << predictor->indirect_bits)
+        || return_stack_load(&predictor->returns, file)) {
+        return 1;
+    }
+    return predictor->shared ? 0 : btb_load(&predictor->own_btb, file);
+}
@@ -0,0 +1,76 @@
+#ifndef TARGET_PREDICTOR_H
+#define TARGET_PREDICTOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "branch_trace.h"
+#include "btb.h"
+#include "return_stack.h"
+
+// Branch target prediction beside a direction predictor, for the fetch-redirect cost of a trace.
+// Conditional branches take their target from a BTB: the direction predictor's own when it has
+// one (targets are then stored in its entries), otherwise a BTB of the same geometry that only
+// holds branches seen taken. Indirect jumps and calls (jalr) take theirs from an indirect target
+// cache: a tagged, direct-mapped table indexed by the jump address XOR a path history of recent
+// taken targets, so one jump can predict different targets on different paths. Returns are
+// predicted by a return address stack that every call pushes, or by the indirect target cache
+// when the stack has depth 0. Direct jumps and calls have their target in the instruction.
+
+typedef struct {
+    uint64_t tag;           // Jump address
+    uint64_t target;
+    bool valid;             // Set once trained, so a jump at address 0 never hits an empty entry
+} IndirectTarget;
+
+typedef struct {
+    BTB own_btb;                    // Used when the direction predictor has no BTB
+    BTB* btb;                       // own_btb or the direction predictor's BTB
+    bool shared;
+    IndirectTarget* indirect;
+    int indirect_bits;
+    uint64_t path_history;          // Low indirect_bits bits of the recent taken targets
+    ReturnStack returns;
+
+    // Lookup of the conditional branch being predicted, taken before the direction update
+    bool target_known;
+    uint64_t predicted_target;
+
+    // Outcomes of the counted branches
+    uint64_t target_mispredictions;     // Correctly predicted taken, but the target was missing or wrong
+    uint64_t indirect_branches;         // Indirect jumps and calls
+    uint64_t indirect_mispredictions;
+    uint64_t calls;                     // Direct and indirect
+    uint64_t return_count;
+    uint64_t return_mispredictions;
+    uint64_t stack_overflows;           // Calls that pushed out the oldest return address
+    uint64_t stack_underflows;          // Returns that found the stack empty
+} TargetPredictor;
+
+// btb is the direction predictor's BTB (created with targets) or NULL to allocate one of
+// btb_entries in ways ways. Returns NULL on failure.
+TargetPredictor* target_predictor_create(BTB* btb, int btb_entries, int ways, BTBReplacement replacement,
+    int indirect_bits, int ras_depth);
+void target_predictor_destroy(TargetPredictor* predictor);
+
+// Looks up the target of a conditional branch; call after the direction predict and before its update
+void target_predictor_lookup(TargetPredictor* predictor, uint64_t address);
+
+// Trains on the outcome of the branch just looked up, after the direction update. When counted, a
+// correctly predicted taken branch with a missing or wrong target counts as a target misprediction.
+void target_predictor_update(TargetPredictor* predictor, const BranchRecord* record, bool predicted_taken, bool counted);
+
+// Predicts and trains on a jump, call or return, adding its outcome to the counts when counted
+void target_predictor_jump(TargetPredictor* predictor, const BranchRecord* record, bool counted);
+
+// Mispredictions of every kind the target predictor counts
+uint64_t target_predictor_mispredictions(const TargetPredictor* predictor);
+
+// Bits of the structures the target predictor adds, beyond a shared BTB
+uint64_t target_predictor_storage_bits(const TargetPredictor* predictor);
+uint64_t target_predictor_memory_bytes(const TargetPredictor* predictor);
+
+int target_predictor_save(const TargetPredictor* predictor, FILE* file);
+int target_predictor_load(TargetPredictor* predictor, FILE* file);
+
+#endif
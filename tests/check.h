@@ -0,0 +1,112 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "branch_trace.h"
+
+// Shared by the tests/check_*.c programs that make check builds and runs from build/. CHECK
+// reports a failed condition with its location on stderr, and check_result turns the count into
+// the exit status. The inputs are generated from fixed seeds, so every run checks the same branches.
+
+static int check_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+    do { \
+        unsigned long long check_actual = (unsigned long long)(actual); \
+        unsigned long long check_expected = (unsigned long long)(expected); \
+        if (check_actual != check_expected) { \
+            fprintf(stderr, "%s:%d: %s is %llu, expected %llu\n", __FILE__, __LINE__, #actual, check_actual, check_expected); \
+            check_failures++; \
+        } \
+    } while (0)
+
+static inline int check_result(const char* name) {
+    if (check_failures > 0) {
+        fprintf(stderr, "%s: %d checks failed\n", name, check_failures);
+        return 1;
+    }
+    fprintf(stderr, "%s: ok\n", name); // stdout may have been redirected to capture a report
+    return 0;
+}
+
+// xorshift64*, so the inputs do not depend on the C library's rand
+static inline uint64_t check_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+#define CHECK_TRACE_SITES 64
+
+// Odd sites jump backwards like a loop, even ones forwards
+static inline uint64_t check_taken_target(uint64_t address) {
+    return (address / 0x40) % 2 ? address - 0x1000 : address + 0x20;
+}
+
+// Conditional branch number index at one of CHECK_TRACE_SITES static branches, with a loop, an
+// alternating or a biased random outcome depending on the site; every fourth site is a compressed
+// c.bnez. trips counts the executions of every site and must start zeroed.
+static inline BranchRecord check_branch(uint64_t* state, unsigned trips[CHECK_TRACE_SITES]) {
+    int site = (int)(check_random(state) % CHECK_TRACE_SITES);
+    unsigned trip = trips[site]++;
+    BranchRecord record;
+    record.address = 0x80000000ULL + (uint64_t)site * 0x40;
+    record.compressed = site % 4 == 3;
+    switch (site % 3) {
+        case 0:
+            record.taken = trip % 8 != 7;
+            break;
+        case 1:
+            record.taken = trip % 2 == 0;
+            break;
+        default:
+            record.taken = check_random(state) % 100 < 70;
+            break;
+    }
+    record.target = record.taken ? check_taken_target(record.address) : record.address + (record.compressed ? 2 : 4);
+    record.kind = BRANCH_CONDITIONAL;
+    return record;
+}
+
+static inline void check_records(BranchRecord* records, size_t count, uint64_t seed) {
+    uint64_t state = seed;
+    unsigned trips[CHECK_TRACE_SITES] = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        records[i] = check_branch(&state, trips);
+    }
+}
+
+// Writes the branches check_records(seed) would generate as a riscvOVPsim trace: every branch is
+// followed by a register change line and the instruction it went to. Returns non-zero on failure.
+static inline int write_check_trace(const char* path, size_t branches, uint64_t seed) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    uint64_t state = seed;
+    unsigned trips[CHECK_TRACE_SITES] = { 0 };
+    for (size_t i = 0; i < branches; i++) {
+        BranchRecord record = check_branch(&state, trips);
+        fprintf(out, "Info 'riscvOVPsim/cpu', 0x%016llx(check+0): Machine %s %s,%llx\n",
+            (unsigned long long)record.address, record.compressed ? "e119" : "00b51463",
+            record.compressed ? "c.bnez  a0" : "bne     a0,a1", (unsigned long long)check_taken_target(record.address));
+        fprintf(out, "Info   a0 00000000 -> 00000001\n");
+        fprintf(out, "Info 'riscvOVPsim/cpu', 0x%016llx(check+0): Machine 00150513 addi    a0,a0,1\n",
+            (unsigned long long)record.target);
+    }
+    return fclose(out) != 0;
+}
+
+#endif
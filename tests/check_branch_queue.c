@@ -0,0 +1,88 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include "check.h"
+#include "branch_queue.h"
+#include "threads.h"
+
+// More records than the ring holds, so the producer has to wait for the consumer
+#define QUEUE_RECORDS (3 * BRANCH_QUEUE_BATCH_SIZE * BRANCH_QUEUE_BATCHES)
+
+typedef struct {
+    BranchQueue* queue;
+    const BranchRecord* records;
+    size_t pushed;
+    bool stopped;               // A push reported the queue cancelled
+} Producer;
+
+static void produce(void* argument) {
+    Producer* producer = (Producer*)argument;
+    for (size_t i = 0; i < QUEUE_RECORDS; i++) {
+        if (branch_queue_push(producer->queue, &producer->records[i])) {
+            producer->stopped = true;
+            break;
+        }
+        producer->pushed++;
+    }
+    branch_queue_close(producer->queue, producer->stopped);
+}
+
+// Every record comes out once, in order, and the queue ends after the last one
+static void check_in_order(const BranchRecord* records) {
+    BranchQueue* queue = branch_queue_create();
+    CHECK(queue != NULL);
+    if (!queue) return;
+    Producer producer = { queue, records, 0, false };
+    Thread thread;
+    CHECK(thread_start(&thread, produce, &producer) == 0);
+
+    BranchRecord* batch = (BranchRecord*)malloc(BRANCH_QUEUE_BATCH_SIZE * sizeof(BranchRecord));
+    size_t popped = 0;
+    size_t count;
+    bool same = true;
+    while ((count = branch_queue_pop(queue, batch, BRANCH_QUEUE_BATCH_SIZE)) > 0) {
+        for (size_t i = 0; i < count && popped + i < QUEUE_RECORDS; i++) {
+            same &= batch[i].address == records[popped + i].address && batch[i].taken == records[popped + i].taken;
+        }
+        popped += count;
+    }
+    thread_join(&thread);
+    CHECK(same);
+    CHECK_EQUAL(popped, QUEUE_RECORDS);
+    CHECK(!producer.stopped);
+    CHECK(!branch_queue_failed(queue));
+    free(batch);
+    branch_queue_destroy(queue);
+}
+
+// A consumer that stops early must not leave the producer blocked on the full ring
+static void check_cancel(const BranchRecord* records) {
+    BranchQueue* queue = branch_queue_create();
+    CHECK(queue != NULL);
+    if (!queue) return;
+    Producer producer = { queue, records, 0, false };
+    Thread thread;
+    CHECK(thread_start(&thread, produce, &producer) == 0);
+
+    BranchRecord* batch = (BranchRecord*)malloc(BRANCH_QUEUE_BATCH_SIZE * sizeof(BranchRecord));
+    CHECK(branch_queue_pop(queue, batch, BRANCH_QUEUE_BATCH_SIZE) > 0);
+    branch_queue_cancel(queue);
+    thread_join(&thread);
+    CHECK(producer.stopped);
+    CHECK(producer.pushed < QUEUE_RECORDS);
+    free(batch);
+    branch_queue_destroy(queue);
+}
+
+int main(void) {
+    BranchRecord* records = (BranchRecord*)malloc(QUEUE_RECORDS * sizeof(BranchRecord));
+    if (!records) {
+        perror("Failed to allocate memory for branch records");
+        return 1;
+    }
+    check_records(records, QUEUE_RECORDS, 3);
+    check_in_order(records);
+    check_cancel(records);
+    free(records);
+    return check_result("check_branch_queue");
+}
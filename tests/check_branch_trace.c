@@ -0,0 +1,86 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include "check.h"
+#include "branch_trace.h"
+#include "filter_file.h"
+
+#define TRACE_RECORDS 5000
+
+static void check_same_record(const BranchRecord* actual, const BranchRecord* expected) {
+    CHECK_EQUAL(actual->address, expected->address);
+    CHECK_EQUAL(actual->target, expected->target);
+    CHECK_EQUAL(actual->taken, expected->taken);
+    CHECK_EQUAL(actual->compressed, expected->compressed);
+    CHECK_EQUAL(actual->kind, expected->kind);
+}
+
+// Every record read back from path must match expected, and nothing more
+static void check_trace_file(const char* path, const BranchRecord* expected, size_t count) {
+    BranchTraceReader* reader = (BranchTraceReader*)malloc(sizeof(BranchTraceReader));
+    CHECK(reader != NULL);
+    if (!reader || branch_trace_open_reader(reader, path)) {
+        CHECK(!"the trace could be opened");
+        free(reader);
+        return;
+    }
+    CHECK_EQUAL(reader->record_count, count);
+    BranchRecord record;
+    size_t read = 0;
+    while (branch_trace_read(reader, &record)) {
+        if (read < count) check_same_record(&record, &expected[read]);
+        read++;
+    }
+    CHECK_EQUAL(read, count);
+    branch_trace_close_reader(reader);
+    free(reader);
+}
+
+// Address deltas of every size and sign, jumps of every kind and targets far from their branch
+static void check_round_trip(void) {
+    BranchRecord records[TRACE_RECORDS];
+    check_records(records, TRACE_RECORDS, 1);
+    records[10].address = 0;
+    records[10].taken = false;
+    records[10].target = 4;
+    records[10].compressed = false;
+    records[11].address = UINT64_MAX - 1;
+    records[11].target = 0x1000;
+    records[11].taken = true;
+    for (int kind = BRANCH_INDIRECT; kind < BRANCH_KIND_COUNT; kind++) {
+        BranchRecord* record = &records[100 + kind];
+        record->kind = (BranchKind)kind;
+        record->taken = true;
+        record->target = record->address + ((uint64_t)1 << 40);
+        record->compressed = kind % 2 == 0;
+    }
+
+    BranchTraceWriter* writer = (BranchTraceWriter*)malloc(sizeof(BranchTraceWriter));
+    CHECK(writer != NULL);
+    if (!writer || branch_trace_open_writer(writer, "check_branch_trace.bin", "check.trc")) {
+        CHECK(!"the trace could be created");
+        free(writer);
+        return;
+    }
+    for (int i = 0; i < TRACE_RECORDS; i++) {
+        CHECK(branch_trace_write(writer, &records[i]) == 0);
+    }
+    CHECK(branch_trace_close_writer(writer) == 0);
+    free(writer);
+    check_trace_file("check_branch_trace.bin", records, TRACE_RECORDS);
+}
+
+// The filter turns a text trace back into the branches it was generated from
+static void check_filter(void) {
+    BranchRecord records[TRACE_RECORDS];
+    check_records(records, TRACE_RECORDS, 2);
+    CHECK(write_check_trace("check_filter.trc", TRACE_RECORDS, 2) == 0);
+    CHECK(filterBranchCommands("check_filter.trc", "check_filter.bin") == 0);
+    check_trace_file("check_filter.bin", records, TRACE_RECORDS);
+}
+
+int main(void) {
+    check_round_trip();
+    check_filter();
+    return check_result("check_branch_trace");
+}
@@ -0,0 +1,74 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include "check.h"
+#include "btb.h"
+
+#define WAYS 4
+
+static int install(BTB* btb, uint64_t address) {
+    return btb_replace(btb, btb_set(btb, address), btb_tag(btb, address));
+}
+
+static bool holds(const BTB* btb, uint64_t address) {
+    return btb_find(btb, btb_set(btb, address), btb_tag(btb, address)) >= 0;
+}
+
+static void touch(BTB* btb, uint64_t address) {
+    BTBSet* set = btb_set(btb, address);
+    int way = btb_find(btb, set, btb_tag(btb, address));
+    CHECK(way >= 0);
+    if (way >= 0) btb_touch(btb, set, way);
+}
+
+// Fills one fully associative set with branches 1..WAYS, hits branch 1 and installs branch 5;
+// returns which of 1..WAYS was evicted, 0 if none or several were
+static int evicted_after_hit(BTBReplacement replacement) {
+    BTB btb;
+    if (btb_init(&btb, WAYS, WAYS, replacement, 0, false)) {
+        CHECK(!"the BTB could be created");
+        return 0;
+    }
+    for (int branch = 1; branch <= WAYS; branch++) {
+        CHECK(!holds(&btb, 0x1000 * (uint64_t)branch));
+        install(&btb, 0x1000 * (uint64_t)branch);
+    }
+    CHECK(btb_set_full(&btb, btb_set(&btb, 0x1000)));
+    touch(&btb, 0x1000);
+    install(&btb, 0x5000);
+    CHECK(holds(&btb, 0x5000));
+
+    int evicted = 0;
+    for (int branch = 1; branch <= WAYS; branch++) {
+        if (!holds(&btb, 0x1000 * (uint64_t)branch)) {
+            evicted = evicted ? -1 : branch;
+        }
+    }
+    btb_free(&btb);
+    return evicted < 0 ? 0 : evicted;
+}
+
+int main(void) {
+    // Branch 2 is the least recently used. The PLRU tree, pointed away from way 3 and then from
+    // way 0, picks way 2 (branch 3). SRRIP ages the inserted entries to distant before the hit one.
+    CHECK_EQUAL(evicted_after_hit(BTB_REPLACE_LRU), 2);
+    CHECK_EQUAL(evicted_after_hit(BTB_REPLACE_PLRU), 3);
+    CHECK_EQUAL(evicted_after_hit(BTB_REPLACE_SRRIP), 2);
+    CHECK(evicted_after_hit(BTB_REPLACE_RANDOM) != 0);
+
+    // Direct-mapped: a branch of the same set replaces the one before it, others stay
+    BTB btb;
+    CHECK(btb_init(&btb, 8, 1, BTB_REPLACE_LRU, 2, false) == 0);
+    uint64_t first = 0x80000000;
+    uint64_t other_set = first + 2;
+    uint64_t same_set = first;
+    while (btb_set(&btb, same_set) != btb_set(&btb, first) || same_set == first) same_set += 2;
+    install(&btb, first);
+    install(&btb, other_set);
+    CHECK(btb_set(&btb, other_set) != btb_set(&btb, first));
+    install(&btb, same_set);
+    CHECK(!holds(&btb, first));
+    CHECK(holds(&btb, other_set));
+    CHECK(holds(&btb, same_set));
+    btb_free(&btb);
+    return check_result("check_btb");
+}
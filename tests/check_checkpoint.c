@@ -0,0 +1,74 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "predictor.h"
+
+#define CHECKPOINT_RECORDS 20000
+
+// A run interrupted halfway and resumed from a checkpoint in fresh predictors must predict the
+// second half exactly as the uninterrupted run did
+static void check_resume(const PredictorConfig* sizing, const BranchRecord* records) {
+    Predictor whole[MAX_PREDICTORS];
+    Predictor first[MAX_PREDICTORS];
+    Predictor resumed[MAX_PREDICTORS];
+    int count = create_predictors(whole, ALL_PREDICTORS, sizing);
+    CHECK(count > 1);
+    CHECK(create_predictors(first, ALL_PREDICTORS, sizing) == count);
+    CHECK(create_predictors(resumed, ALL_PREDICTORS, sizing) == count);
+
+    size_t half = CHECKPOINT_RECORDS / 2;
+    SimulateRecords(records, CHECKPOINT_RECORDS, whole, count);
+    SimulateRecords(records, half, first, count);
+    CHECK(SaveCheckpoint("check_checkpoint.ckpt", first, count) == 0);
+    CHECK(LoadCheckpoint("check_checkpoint.ckpt", resumed, count) == 0);
+    SimulateRecords(records + half, CHECKPOINT_RECORDS - half, resumed, count);
+
+    for (int i = 0; i < count; i++) {
+        CHECK_EQUAL(resumed[i].total_branches, CHECKPOINT_RECORDS - half);
+        CHECK_EQUAL(first[i].mispredictions + resumed[i].mispredictions, whole[i].mispredictions);
+        if (first[i].mispredictions + resumed[i].mispredictions != whole[i].mispredictions) {
+            fprintf(stderr, "  %s resumed differently\n", whole[i].name);
+        }
+    }
+    destroy_predictors(whole, count);
+    destroy_predictors(first, count);
+    destroy_predictors(resumed, count);
+}
+
+// A checkpoint only restores into predictors of the configuration that saved it
+static void check_mismatch(const PredictorConfig* sizing) {
+    PredictorConfig other = *sizing;
+    other.ghr_bits++;
+    Predictor predictors[MAX_PREDICTORS];
+    int count = create_predictors(predictors, ALL_PREDICTORS, &other);
+    CHECK(count > 1);
+    CHECK(LoadCheckpoint("check_checkpoint.ckpt", predictors, count) != 0);
+    destroy_predictors(predictors, count);
+}
+
+int main(void) {
+    BranchRecord* records = (BranchRecord*)malloc(CHECKPOINT_RECORDS * sizeof(BranchRecord));
+    if (!records) {
+        perror("Failed to allocate memory for branch records");
+        return 1;
+    }
+    check_records(records, CHECKPOINT_RECORDS, 6);
+
+    PredictorConfig sizing;
+    memset(&sizing, 0, sizeof(sizing));
+    sizing.ghr_bits = 8;
+    sizing.bhr_bits = 4;
+    sizing.btb_entries = 256;
+    sizing.btb_ways = 2;
+    sizing.btb_replacement = BTB_REPLACE_LRU;
+    sizing.chooser_bits = DEFAULT_CHOOSER_BITS;
+    sizing.chooser_index = CHOOSER_INDEX_PC;
+    sizing.indirect_bits = DEFAULT_INDIRECT_BITS;
+    sizing.ras_depth = DEFAULT_RAS_DEPTH;
+    check_resume(&sizing, records);
+    check_mismatch(&sizing);
+    free(records);
+    return check_result("check_checkpoint");
+}
@@ -0,0 +1,52 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <string.h>
+#include "check.h"
+#include "branch_classifier.h"
+
+typedef struct {
+    const char* line;
+    BranchKind kind;
+    int instruction_bytes;
+} ClassifiedLine;
+
+static const ClassifiedLine lines[] = {
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000104(main+4): Machine 00b50463 beq     a0,a1,8000010c", BRANCH_CONDITIONAL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x000000008000066c(helper+620): Machine e119 c.bnez  a0,80000674", BRANCH_CONDITIONAL, 2 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000108(main+8): Machine 00b57463 bgeu    a0,a1,80000110", BRANCH_CONDITIONAL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x000000008000010c(main+12): Machine 00b54463 bgt     a1,a0,80000114", BRANCH_CONDITIONAL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000100(main+0): Machine 00150513 addi    a0,a0,1", BRANCH_NONE, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000100(main+0): Machine 0001 nop     ", BRANCH_NONE, 2 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000110(main+16): Machine 0080006f j       80000118", BRANCH_JUMP, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000110(main+16): Machine a801 c.j     80000120", BRANCH_JUMP, 2 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000114(main+20): Machine 0c8000ef jal     ra,800001dc", BRANCH_CALL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000114(main+20): Machine 0c8000ef jal     800001dc", BRANCH_CALL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000114(main+20): Machine 0c80006f jal     zero,800001dc", BRANCH_JUMP, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000118(main+24): Machine 000780e7 jalr    a5", BRANCH_INDIRECT_CALL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000118(main+24): Machine 000780e7 jalr    ra,0(a5)", BRANCH_INDIRECT_CALL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000118(main+24): Machine 00078067 jalr    zero,0(a5)", BRANCH_INDIRECT, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000118(main+24): Machine 00008067 jalr    zero,0(ra)", BRANCH_RETURN, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x000000008000011c(main+28): Machine 9782 c.jalr  a5", BRANCH_INDIRECT_CALL, 2 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000120(main+32): Machine 8782 c.jr    a5", BRANCH_INDIRECT, 2 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000120(main+32): Machine 00028067 jr      t0", BRANCH_RETURN, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000124(main+36): Machine 8082 ret     ", BRANCH_RETURN, 2 },
+    // C++ symbols hold colons of their own
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000128(ns::fn+4): Machine 00b50463 beq     a0,a1,80000130", BRANCH_CONDITIONAL, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000128(a::b::c+4): Machine 8082 ret     ", BRANCH_RETURN, 2 },
+    // Neither an instruction nor a near miss of a branch mnemonic
+    { "Info   a0 00000000 -> 00000001", BRANCH_NONE, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000128(main+40): Machine 00b50463 beqq    a0,a1,80000130", BRANCH_NONE, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000128(main+40): Machine 00b50463 be      a0,a1,80000130", BRANCH_NONE, 4 },
+    { "Info 'riscvOVPsim/cpu', 0x0000000080000128(main+40): Machine 00b50463 add     a0,a1,beq", BRANCH_NONE, 4 },
+};
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        int instruction_bytes = 0;
+        BranchKind kind = classify_trace_line(lines[i].line, strlen(lines[i].line), &instruction_bytes);
+        CHECK_EQUAL(kind, lines[i].kind);
+        if (kind != BRANCH_NONE) CHECK_EQUAL(instruction_bytes, lines[i].instruction_bytes);
+        if (kind != lines[i].kind) fprintf(stderr, "  for %s\n", lines[i].line);
+    }
+    return check_result("check_classifier");
+}
@@ -0,0 +1,73 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include "check.h"
+#include "history.h"
+
+// The fold computed from scratch: the outcome age branches ago lands on bit age % width
+static uint32_t fold(const GlobalHistory* history, int length, int width) {
+    uint32_t value = 0;
+    for (int age = 0; age < length; age++) {
+        value ^= (uint32_t)history_bit(history, age) << (age % width);
+    }
+    return value;
+}
+
+static void check_folded(int length, int width, uint64_t seed) {
+    GlobalHistory history;
+    if (history_init(&history, length)) {
+        CHECK(!"the history could be created");
+        return;
+    }
+    FoldedHistory folded;
+    folded_history_init(&folded, length, width);
+
+    uint64_t state = seed;
+    bool same = true;
+    for (int i = 0; i < 4 * length + 100; i++) {
+        history_push(&history, check_random(&state) % 3 != 0);
+        folded_history_update(&folded, &history);
+        same &= folded.value == fold(&history, length, width);
+    }
+    if (!same) fprintf(stderr, "folding %d outcomes into %d bits differs from the reference\n", length, width);
+    CHECK(same);
+    history_free(&history);
+}
+
+// A register no longer than its index is the plain history, newest outcome in bit 0
+static void check_register(int length, int index_bits) {
+    GlobalHistoryRegister ghr;
+    if (ghr_init(&ghr, length, index_bits)) {
+        CHECK(!"the register could be created");
+        return;
+    }
+    uint64_t state = 7;
+    uint32_t plain = 0;
+    bool same = true;
+    for (int i = 0; i < 200; i++) {
+        bool taken = check_random(&state) & 1;
+        ghr_push(&ghr, taken);
+        plain = ((plain << 1) | taken) & ((1u << length) - 1);
+        if (length <= index_bits) same &= ghr_index(&ghr) == plain;
+        else same &= ghr_index(&ghr) == fold(&ghr.history, length, index_bits);
+    }
+    CHECK(same);
+
+    // Pushing a full register's worth of bits at once leaves exactly those bits
+    ghr_push_bits(&ghr, 0x2D, length);
+    if (length <= index_bits) CHECK_EQUAL(ghr_index(&ghr), 0x2Du & ((1u << length) - 1));
+    ghr_free(&ghr);
+}
+
+int main(void) {
+    int lengths[] = { 1, 5, 8, 15, 16, 17, 44, 64, 130 };
+    int widths[] = { 1, 7, 8, 10, 12, 16 };
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+            check_folded(lengths[l], widths[w], 11 + l * 16 + w);
+        }
+    }
+    check_register(6, 10);
+    check_register(10, 10);
+    check_register(20, 10);
+    return check_result("check_history");
+}
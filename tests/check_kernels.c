@@ -0,0 +1,80 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "predictor.h"
+
+#define KERNEL_RECORDS 20000
+#define KERNEL_WARMUP 1000
+
+static void sizing_for(PredictorConfig* sizing, int ghr_bits, int bhr_bits, int entries, int ways) {
+    memset(sizing, 0, sizeof(*sizing));
+    sizing->ghr_bits = ghr_bits;
+    sizing->bhr_bits = bhr_bits;
+    sizing->btb_entries = entries;
+    sizing->btb_ways = ways;
+    sizing->btb_replacement = BTB_REPLACE_LRU;
+    sizing->chooser_bits = DEFAULT_CHOOSER_BITS;
+    sizing->chooser_index = CHOOSER_INDEX_PC;
+    sizing->indirect_bits = DEFAULT_INDIRECT_BITS;
+    sizing->ras_depth = DEFAULT_RAS_DEPTH;
+}
+
+// Runs the records through the predictor's specialised kernel and through a copy forced onto the
+// generic predict/update loop, in two calls so the state written back between batches is covered
+static void check_kernel(int which_predictor, const PredictorConfig* sizing, const BranchRecord* records) {
+    Predictor kernel[MAX_PREDICTORS];
+    Predictor generic[MAX_PREDICTORS];
+    int count = create_predictors(kernel, which_predictor, sizing);
+    CHECK(count == 1 && create_predictors(generic, which_predictor, sizing) == count);
+    if (count != 1) return;
+// Builds without kernels compare the generic loop with itself
+#if !defined(PREDICTOR_GENERIC_ONLY) && !defined(PREDICTOR_EVENTS)
+    if (!kernel[0].kernel) {
+        fprintf(stderr, "%s (ghr_bits %d, bhr_bits %d, entries %d, %d ways) has no kernel\n",
+            kernel[0].name, sizing->ghr_bits, sizing->bhr_bits, sizing->btb_entries, sizing->btb_ways);
+    }
+    CHECK(kernel[0].kernel != NULL);
+#endif
+    generic[0].kernel = NULL;
+
+    set_warmup_branches(kernel, 1, KERNEL_WARMUP);
+    set_warmup_branches(generic, 1, KERNEL_WARMUP);
+    SimulateRecords(records, KERNEL_RECORDS / 2, kernel, 1);
+    SimulateRecords(records, KERNEL_RECORDS / 2, generic, 1);
+    SimulateRecords(records + KERNEL_RECORDS / 2, KERNEL_RECORDS / 2, kernel, 1);
+    SimulateRecords(records + KERNEL_RECORDS / 2, KERNEL_RECORDS / 2, generic, 1);
+    CHECK_EQUAL(kernel[0].total_branches, KERNEL_RECORDS - KERNEL_WARMUP);
+    CHECK_EQUAL(kernel[0].total_branches, generic[0].total_branches);
+    CHECK_EQUAL(kernel[0].mispredictions, generic[0].mispredictions);
+    destroy_predictors(kernel, 1);
+    destroy_predictors(generic, 1);
+}
+
+int main(void) {
+    BranchRecord* records = (BranchRecord*)malloc(KERNEL_RECORDS * sizeof(BranchRecord));
+    if (!records) {
+        perror("Failed to allocate memory for branch records");
+        return 1;
+    }
+    check_records(records, KERNEL_RECORDS, 5);
+
+    PredictorConfig sizing;
+    for (int ghr_bits = 2; ghr_bits <= 16; ghr_bits += 7) {
+        sizing_for(&sizing, ghr_bits, 3, 2048, 2);
+        check_kernel(2, &sizing, records);   // Global
+    }
+    for (int ghr_bits = 4; ghr_bits <= 16; ghr_bits += 6) {
+        sizing_for(&sizing, ghr_bits, 3, 2048, 2);
+        check_kernel(5, &sizing, records);   // Gshare
+    }
+    sizing_for(&sizing, 6, 3, 2048, 2);
+    check_kernel(0, &sizing, records);       // Local_private_FSM, 2 ways
+    sizing_for(&sizing, 6, 4, 1024, 4);
+    check_kernel(0, &sizing, records);       // 4 ways, small enough to evict
+    sizing_for(&sizing, 6, 8, 4096, 2);
+    check_kernel(0, &sizing, records);
+    free(records);
+    return check_result("check_kernels");
+}
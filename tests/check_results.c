@@ -0,0 +1,83 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "results.h"
+
+static const char* traces[] = { "plain.trc", "a,b.trc", "say \"hi\".trc", "back\\slash\ttab.trc", "line\nbreak.trc" };
+#define TRACE_COUNT (sizeof(traces) / sizeof(traces[0]))
+
+static char* read_text(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+    char* text = (char*)calloc(1 << 16, 1);
+    if (text) fread(text, 1, (1 << 16) - 1, file);
+    fclose(file);
+    return text;
+}
+
+static int write_rows(const char* path) {
+    PredictorConfig sizing;
+    memset(&sizing, 0, sizeof(sizing));
+    sizing.ghr_bits = 6;
+    sizing.bhr_bits = 3;
+    sizing.btb_entries = 2048;
+    sizing.btb_ways = 2;
+    sizing.btb_replacement = BTB_REPLACE_LRU;
+    sizing.chooser_bits = DEFAULT_CHOOSER_BITS;
+    sizing.chooser_index = CHOOSER_INDEX_PC;
+    sizing.indirect_bits = DEFAULT_INDIRECT_BITS;
+    sizing.ras_depth = DEFAULT_RAS_DEPTH;
+
+    ResultsSink sink;
+    if (results_open(&sink, path)) return 1;
+    for (size_t i = 0; i < TRACE_COUNT; i++) {
+        ResultRow row;
+        memset(&row, 0, sizeof(row));
+        row.trace = traces[i];
+        row.predictor = "Global";
+        row.sizing = &sizing;
+        row.total_branches = 1000;
+        row.mispredictions = 250;
+        row.targets = i == 0;
+        row.target_mispredictions = 7;
+        row.fetch_redirects = 257;
+        results_write(&sink, &row);
+    }
+    return results_close(&sink);
+}
+
+int main(void) {
+    CHECK(write_rows("check_results.csv") == 0);
+    CHECK(write_rows("check_results.json") == 0);
+    char* csv = read_text("check_results.csv");
+    char* json = read_text("check_results.json");
+    CHECK(csv && json);
+    if (csv && json) {
+        // RFC 4180: fields with commas, quotes or line breaks are quoted, quotes doubled
+        CHECK(strstr(csv, "\nplain.trc,Global,") != NULL);
+        CHECK(strstr(csv, "\n\"a,b.trc\",Global,") != NULL);
+        CHECK(strstr(csv, "\n\"say \"\"hi\"\".trc\",Global,") != NULL);
+        CHECK(strstr(csv, "\nback\\slash\ttab.trc,Global,") != NULL);
+        CHECK(strstr(csv, "\n\"line\nbreak.trc\",Global,") != NULL);
+        // Target counts only for rows that predicted targets
+        CHECK(strstr(csv, ",1,10,16,7,0,0,257\n") != NULL);
+        CHECK(strstr(csv, ",0,10,16,,,,\n") != NULL);
+
+        CHECK(strstr(json, "{\"trace\": \"plain.trc\", ") != NULL);
+        CHECK(strstr(json, "{\"trace\": \"a,b.trc\", ") != NULL);
+        CHECK(strstr(json, "{\"trace\": \"say \\\"hi\\\".trc\", ") != NULL);
+        CHECK(strstr(json, "{\"trace\": \"back\\\\slash\\u0009tab.trc\", ") != NULL);
+        CHECK(strstr(json, "{\"trace\": \"line\\u000abreak.trc\", ") != NULL);
+        CHECK(strstr(json, "\"target_mispredictions\": 7, ") != NULL);
+        CHECK(strstr(json, "\"target_mispredictions\": null, ") != NULL);
+        CHECK(json[0] == '[' && strstr(json, "}\n]\n") != NULL);
+    }
+    free(csv);
+    free(json);
+    return check_result("check_results");
+}
@@ -0,0 +1,111 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "config.h"
+#include "filter_file.h"
+#include "predictor.h"
+#include "shards.h"
+
+#define SHARDED_BRANCHES 30000
+
+static const char* trace = "check_sharded.trc";
+
+static int write_config(const char* path, int shards, uint64_t shard_warmup) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    fprintf(out, "ghr_bits = 8\nbhr_bits = 4\nentries = 256\nwhich_predictor = 4\nthreads = 2\n");
+    fprintf(out, "shards = %d\nshard_warmup = %llu\n", shards, (unsigned long long)shard_warmup);
+    return fclose(out) != 0;
+}
+
+// Whole contents of a text file, or NULL
+static char* read_text(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)calloc((size_t)size + 1, 1);
+    if (text && fread(text, 1, (size_t)size, file) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    fclose(file);
+    return text;
+}
+
+// The serial run's report, printed with the trace as its label like the sharded run does
+static int run_serial(const char* output) {
+    Config config;
+    read_config(&config, "check_sharded.cfg");
+    PredictorConfig sizing;
+    config_predictor_sizing(&config, config.ghr_bits.values[0], config.bhr_bits.values[0], config.entries.values[0], &sizing);
+    Predictor predictors[MAX_PREDICTORS];
+    int count = create_predictors(predictors, config.which_predictor, &sizing);
+    if (count == 0 || filterBranchCommands(trace, "check_sharded.bin") || RunPredictors("check_sharded.bin", predictors, count)) {
+        destroy_predictors(predictors, count);
+        return 1;
+    }
+    fflush(stdout);
+    if (!freopen(output, "w", stdout)) return 1;
+    PrintResults(trace, predictors, count);
+    fflush(stdout);
+    destroy_predictors(predictors, count);
+    return 0;
+}
+
+static int run_sharded(const char* output, int shards, uint64_t shard_warmup) {
+    Config config;
+    if (write_config("check_sharded.cfg", shards, shard_warmup)) return 1;
+    read_config(&config, "check_sharded.cfg");
+    fflush(stdout);
+    if (!freopen(output, "w", stdout)) return 1;
+    int result = RunSharded(&config, &trace, 1);
+    fflush(stdout);
+    return result;
+}
+
+// Length of the report up to the end of its storage row; the event rows of -DPREDICTOR_EVENTS
+// builds that follow count the replayed warm-up branches too, so they differ when sharded
+static size_t results_length(const char* report) {
+    const char* storage = strstr(report, "Storage (KiB):");
+    const char* end = storage ? strchr(storage, '\n') : NULL;
+    return end ? (size_t)(end + 1 - report) : strlen(report);
+}
+
+int main(void) {
+    if (write_check_trace(trace, SHARDED_BRANCHES, 8) || write_config("check_sharded.cfg", 0, 0)) {
+        return 1;
+    }
+    CHECK(run_serial("check_serial.txt") == 0);
+
+    // A warm-up reaching back to the start of the trace makes every chunk exact, so the sharded
+    // report starts with the serial one and bounds the error at 0
+    CHECK(run_sharded("check_sharded_exact.txt", 7, SHARDED_BRANCHES) == 0);
+    // Too short a warm-up gives no bound rather than a false 0
+    CHECK(run_sharded("check_sharded_cold.txt", 4, 0) == 0);
+
+    char* serial = read_text("check_serial.txt");
+    char* exact = read_text("check_sharded_exact.txt");
+    char* cold = read_text("check_sharded_cold.txt");
+    CHECK(serial && exact && cold);
+    if (serial && exact && cold) {
+        size_t length = results_length(serial);
+        CHECK(strncmp(exact, serial, length) == 0);
+        CHECK(strstr(exact + length, "+/- 0 mispredictions") != NULL);
+        CHECK(strstr(exact + length, "unknown") == NULL);
+        CHECK(strstr(cold, "unknown") != NULL);
+    }
+    free(serial);
+    free(exact);
+    free(cold);
+    return check_result("check_sharded");
+}
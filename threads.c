@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads.h"
+
+typedef struct {
+    ThreadFunction function;
+    void* argument;
+} ThreadStart;
+
+#ifdef _WIN32
+
+static DWORD WINAPI thread_entry(LPVOID parameter) {
+    ThreadStart start = *(ThreadStart*)parameter;
+    free(parameter);
+    start.function(start.argument);
+    return 0;
+}
+
+int thread_start(Thread* thread, ThreadFunction function, void* argument) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!start) {
+        perror("Failed to allocate memory for thread");
+        return 1;
+    }
+    start->function = function;
+    start->argument = argument;
+
+    thread->handle = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (!thread->handle) {
+        fprintf(stderr, "Failed to start thread\n");
+        free(start);
+        return 1;
+    }
+    return 0;
+}
+
+void thread_join(Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+void mutex_init(Mutex* mutex) { InitializeCriticalSection(mutex); }
+void mutex_lock(Mutex* mutex) { EnterCriticalSection(mutex); }
+void mutex_unlock(Mutex* mutex) { LeaveCriticalSection(mutex); }
+void mutex_destroy(Mutex* mutex) { DeleteCriticalSection(mutex); }
+
+void cond_init(CondVar* cond) { InitializeConditionVariable(cond); }
+void cond_wait(CondVar* cond, Mutex* mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void cond_signal(CondVar* cond) { WakeConditionVariable(cond); }
+void cond_broadcast(CondVar* cond) { WakeAllConditionVariable(cond); }
+void cond_destroy(CondVar* cond) { (void)cond; }
+
+#else
+
+static void* thread_entry(void* parameter) {
+    ThreadStart start = *(ThreadStart*)parameter;
+    free(parameter);
+    start.function(start.argument);
+    return NULL;
+}
+
+int thread_start(Thread* thread, ThreadFunction function, void* argument) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!start) {
+        perror("Failed to allocate memory for thread");
+        return 1;
+    }
+    start->function = function;
+    start->argument = argument;
+
+    if (pthread_create(&thread->handle, NULL, thread_entry, start) != 0) {
+        fprintf(stderr, "Failed to start thread\n");
+        free(start);
+        return 1;
+    }
+    return 0;
+}
+
+void thread_join(Thread* thread) {
+    pthread_join(thread->handle, NULL);
+}
+
+void mutex_init(Mutex* mutex) { pthread_mutex_init(mutex, NULL); }
+void mutex_lock(Mutex* mutex) { pthread_mutex_lock(mutex); }
+void mutex_unlock(Mutex* mutex) { pthread_mutex_unlock(mutex); }
+void mutex_destroy(Mutex* mutex) { pthread_mutex_destroy(mutex); }
+
+void cond_init(CondVar* cond) { pthread_cond_init(cond, NULL); }
+void cond_wait(CondVar* cond, Mutex* mutex) { pthread_cond_wait(cond, mutex); }
+void cond_signal(CondVar* cond) { pthread_cond_signal(cond); }
+void cond_broadcast(CondVar* cond) { pthread_cond_broadcast(cond); }
+void cond_destroy(CondVar* cond) { pthread_cond_destroy(cond); }
+
+#endif
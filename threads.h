@@ -0,0 +1,34 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+// Minimal portable wrapper over pthreads / Win32 threads
+
+#ifdef _WIN32
+#include <windows.h>
+typedef struct { HANDLE handle; } Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE CondVar;
+#else
+#include <pthread.h>
+typedef struct { pthread_t handle; } Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+#endif
+
+typedef void (*ThreadFunction)(void* argument);
+
+int thread_start(Thread* thread, ThreadFunction function, void* argument);
+void thread_join(Thread* thread);
+
+void mutex_init(Mutex* mutex);
+void mutex_lock(Mutex* mutex);
+void mutex_unlock(Mutex* mutex);
+void mutex_destroy(Mutex* mutex);
+
+void cond_init(CondVar* cond);
+void cond_wait(CondVar* cond, Mutex* mutex);
+void cond_signal(CondVar* cond);
+void cond_broadcast(CondVar* cond);
+void cond_destroy(CondVar* cond);
+
+#endif
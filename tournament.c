@@ -5,243 +5,252 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include "btb.h"
+#include "counter_table.h"
+#include "events.h"
+#include "history.h"
+#include "predictor.h"
 
-// Local Predictor Structures
 typedef struct {
-
+    BTB btb;                        // Local predictor: per-entry BHR and private 2-bit counters
+    GlobalHistoryRegister global_ghr;   // Global GHR shared among all branches, folded when longer than the table index
+    CounterTable shared_counters;   // Packed 2-bit counters for global predictor
+    CounterTable chooser;           // 2^chooser_bits packed 2-bit counters, MSB set favors local
+    FoldedHistory chooser_history;  // Global history folded to chooser_bits for GHR-indexed choosers
+    ChooserIndex chooser_indexing;
+    uint64_t chooser_mask;
+    int local_bhr_bits;
+    int global_ghr_bits;
+    int local_bhr_mask;
+    BTBSet* set;                    // State of the branch being predicted, reused by the update
     uint64_t tag;
-    uint8_t bhr;
-    uint8_t* counters; // Dynamic 2-bit counters for local predictor
-    bool valid;
-} BTBEntry;
-
-typedef struct {
-    BTBEntry entries[2];
-    bool lru_bit; // LRU bit to track the least recently used entry
-} BTBSet;
+    int way;
+    uint64_t chooser_index;
+    bool local_prediction;
+    bool global_prediction;
+    bool use_local;
+    AliasTracker aliasing;          // Last branch to train each global counter, event builds only
+    EventCounters events;
+} TournamentPredictor;
+
+static int initialize_predictors(TournamentPredictor* predictor, int global_ghr_bits, int global_index_bits, int chooser_bits) {
+    if (chooser_bits < 0 || chooser_bits > MAX_FOLDED_BITS) {
+        fprintf(stderr, "chooser_bits must be between 0 and %d, not %d\n", MAX_FOLDED_BITS, chooser_bits);
+        return 1;
+    }
+    if (ghr_init(&predictor->global_ghr, global_ghr_bits, global_index_bits)) {
+        return 1;
+    }
+    folded_history_init(&predictor->chooser_history, global_ghr_bits, chooser_bits);
+    predictor->chooser_mask = (1ULL << chooser_bits) - 1;
 
-uint8_t global_ghr = 0; // Global GHR shared among all branches
-static uint8_t* shared_counters = NULL; // Dynamic array of 2-bit counters for global predictor
-uint8_t chooser[1024]; // Array of 2-bit saturating counters
+    // Both tables start at 01: global counters 'weakly not taken', chooser 'weakly favor global'
+    if (counter_table_init(&predictor->shared_counters, (size_t)1 << global_index_bits)) {
+        ghr_free(&predictor->global_ghr);
+        return 1;
+    }
+    if (counter_table_init(&predictor->chooser, (size_t)1 << chooser_bits)) {
+        counter_table_free(&predictor->shared_counters);
+        ghr_free(&predictor->global_ghr);
+        return 1;
+    }
+    return 0;
+}
 
-static void initialize_predictors(BTBSet btb[], int btb_sets, int global_counter_size, int chooser_size, int local_bhr_size) {
-    for (int i = 0; i < btb_sets; i++) {
-        btb[i].entries[0].valid = false;
-        btb[i].entries[1].valid = false;
-        btb[i].lru_bit = false; // Start with the first entry as LRU
+static bool predict_local(const BTB* btb, BTBSet* set, int way) {
+    if (way >= 0) {
+        return packed_counter_predict(btb_counters(btb, set, way), *btb_bhr(btb, set, way));
+    }
 
-        // Allocate counters dynamically for each entry
-        btb[i].entries[0].counters = (uint8_t*)malloc(local_bhr_size * sizeof(uint8_t));
-        btb[i].entries[1].counters = (uint8_t*)malloc(local_bhr_size * sizeof(uint8_t));
-        if (!btb[i].entries[0].counters || !btb[i].entries[1].counters) {
-            perror("Failed to allocate memory for local predictor counters");
-            exit(EXIT_FAILURE);
-        }
+    return true; // Default prediction if not found
+}
 
-        // Initialize counters to 'weakly not taken' (01)
-        memset(btb[i].entries[0].counters, 1, local_bhr_size * sizeof(uint8_t));
-        memset(btb[i].entries[1].counters, 1, local_bhr_size * sizeof(uint8_t));
-    }
+static bool predict_global(TournamentPredictor* predictor) {
+    return counter_table_predict(&predictor->shared_counters, ghr_index(&predictor->global_ghr));
+}
 
-    // Allocate and initialize the global counters to 'weakly not taken' (01)
-    shared_counters = (uint8_t*)malloc(global_counter_size * sizeof(uint8_t));
-    if (!shared_counters) {
-        perror("Failed to allocate memory for global counters");
-        exit(EXIT_FAILURE);
+static void update_local(TournamentPredictor* predictor, BTBSet* set, int way, uint64_t tag, bool taken) {
+    if (way >= 0) {
+        uint16_t* bhr = btb_bhr(&predictor->btb, set, way);
+        uint16_t bhr_value = *bhr;
+        packed_counter_update(btb_counters(&predictor->btb, set, way), bhr_value, taken);
+        *bhr = (uint16_t)((bhr_value << 1) | (taken ? 1 : 0)) & predictor->local_bhr_mask;
+        btb_touch(&predictor->btb, set, way);
     }
-    memset(shared_counters, 1, global_counter_size * sizeof(uint8_t));
-
-    // Initialize the chooser array to 'weakly favor global' (01)
-    for (int i = 0; i < chooser_size; i++) {
-        chooser[i] = 1; 
+    else {
+        // Replace the policy's victim; it starts with no history and fresh counters
+        COUNT_EVENT(&predictor->events, btb_set_full(&predictor->btb, set) ? EVENT_BTB_EVICTIONS : EVENT_BTB_COLD_MISSES);
+        btb_replace(&predictor->btb, set, tag);
     }
 }
 
-static uint16_t get_index(uint64_t address, int index_bits) {
-    return (address & ((1ULL << index_bits) - 1));
+static void update_global(TournamentPredictor* predictor, uint64_t branch_address, bool taken) {
+    alias_tracker_update(&predictor->aliasing, &predictor->events, ghr_index(&predictor->global_ghr), branch_address,
+        predictor->global_prediction != taken);
+    counter_table_update(&predictor->shared_counters, ghr_index(&predictor->global_ghr), taken);
+    ghr_push(&predictor->global_ghr, taken);
+    folded_history_update(&predictor->chooser_history, &predictor->global_ghr.history);
 }
 
-static uint64_t get_tag(uint64_t address, int index_bits) {
-    return (address >> index_bits);
+static uint64_t map_chooser_index(const TournamentPredictor* predictor, uint64_t branch_address) {
+    switch (predictor->chooser_indexing) {
+        case CHOOSER_INDEX_GHR:
+            return predictor->chooser_history.value;
+        case CHOOSER_INDEX_PC_XOR_GHR:
+            return (branch_address ^ predictor->chooser_history.value) & predictor->chooser_mask;
+        default:
+            return branch_address & predictor->chooser_mask;
+    }
 }
 
-static bool predict_local(BTBSet btb[], uint64_t address, int index_bits, int btb_sets) {
-    uint16_t index = get_index(address, index_bits);
-    uint64_t tag = get_tag(address, index_bits);
+static bool tournament_predict(void* state, uint64_t branch_address) {
+    TournamentPredictor* predictor = (TournamentPredictor*)state;
 
-    BTBSet* set = &btb[index % btb_sets];
-    BTBEntry* entry = NULL;
+    predictor->chooser_index = map_chooser_index(predictor, branch_address); // Map branch to chooser index
 
-    // Search for the entry by comparing tags of both entries in the set
-    if (set->entries[0].valid && set->entries[0].tag == tag) {
-        entry = &set->entries[0];
-    }
-    else if (set->entries[1].valid && set->entries[1].tag == tag) {
-        entry = &set->entries[1];
-    }
+    // Look the branch up once; the same set and way serve both prediction and update
+    predictor->set = btb_set(&predictor->btb, branch_address);
+    predictor->tag = btb_tag(&predictor->btb, branch_address);
+    predictor->way = btb_find(&predictor->btb, predictor->set, predictor->tag);
+    COUNT_EVENT(&predictor->events, EVENT_BTB_LOOKUPS);
+    COUNT_EVENT(&predictor->events, predictor->way >= 0 ? EVENT_BTB_HITS : EVENT_BTB_MISSES);
 
-    if (entry) {
-        uint8_t bhr_value = entry->bhr;
-        uint8_t counter = entry->counters[bhr_value];
-        return (counter >> 1) & 0x1; // MSB of the 2-bit counter
-    }
+    predictor->local_prediction = predict_local(&predictor->btb, predictor->set, predictor->way);
+    predictor->global_prediction = predict_global(predictor);
 
-    return true; // Default prediction if not found
-}
+    // Determine which predictor to use based on the chooser's MSB
+    predictor->use_local = counter_table_predict(&predictor->chooser, predictor->chooser_index); // MSB of chooser counter
 
-static bool predict_global() {
-    uint8_t counter = shared_counters[global_ghr];
-    return (counter >> 1) & 0x1; // MSB of the 2-bit counter
+    return predictor->use_local ? predictor->local_prediction : predictor->global_prediction;
 }
 
-static void update_local(BTBSet btb[], uint64_t address, bool taken, int index_bits, int btb_sets, int local_bhr_mask) {
-    uint16_t index = get_index(address, index_bits);
-    uint64_t tag = get_tag(address, index_bits);
-
-    BTBSet* set = &btb[index % btb_sets];
-    BTBEntry* entry = NULL;
+static void tournament_update(void* state, uint64_t branch_address, bool taken) {
+    TournamentPredictor* predictor = (TournamentPredictor*)state;
 
-    // Search for the entry by comparing tags of both entries in the set
-    if (set->entries[0].valid && set->entries[0].tag == tag) {
-        entry = &set->entries[0];
-    }
-    else if (set->entries[1].valid && set->entries[1].tag == tag) {
-        entry = &set->entries[1];
+    COUNT_EVENT(&predictor->events, predictor->use_local ? EVENT_CHOSE_LOCAL : EVENT_CHOSE_GLOBAL);
+    if ((predictor->use_local ? predictor->local_prediction : predictor->global_prediction) == taken) {
+        COUNT_EVENT(&predictor->events, predictor->use_local ? EVENT_CHOSE_LOCAL_CORRECT : EVENT_CHOSE_GLOBAL_CORRECT);
     }
+    if (predictor->local_prediction == taken) COUNT_EVENT(&predictor->events, EVENT_LOCAL_CORRECT);
+    if (predictor->global_prediction == taken) COUNT_EVENT(&predictor->events, EVENT_GLOBAL_CORRECT);
 
-    if (entry) {
-        uint8_t bhr_value = entry->bhr;
-        if (taken) {
-            if (entry->counters[bhr_value] < 3) entry->counters[bhr_value]++;
-        }
-        else {
-            if (entry->counters[bhr_value] > 0) entry->counters[bhr_value]--;
-        }
-        entry->bhr = ((entry->bhr << 1) | (taken ? 1 : 0)) & local_bhr_mask;
-    }
-    else {
-        int entry_index = set->lru_bit ? 1 : 0; // Select the LRU entry for replacement
-        entry = &set->entries[entry_index];
+    update_local(predictor, predictor->set, predictor->way, predictor->tag, taken);
+    update_global(predictor, branch_address, taken);
 
-        entry->tag = tag;
-        entry->valid = true;
-        entry->bhr = 0; // Start with no history
-        memset(entry->counters, 1, 8 * sizeof(uint8_t)); // Initialize counters to 'weakly not taken' (01)
+    // Update chooser based on which predictor was correct; when they disagree exactly one of them is,
+    // so move towards favoring local if it was local and towards favoring global otherwise
+    if (predictor->local_prediction != predictor->global_prediction) {
+        counter_table_update(&predictor->chooser, predictor->chooser_index, predictor->local_prediction == taken);
     }
-
-    set->lru_bit = (entry == &set->entries[0]) ? 1 : 0;
 }
 
-static void update_global(bool taken, int global_ghr_mask) {
-    if (taken) {
-        if (shared_counters[global_ghr] < 3) shared_counters[global_ghr]++;
-    }
-    else {
-        if (shared_counters[global_ghr] > 0) shared_counters[global_ghr]--;
-    }
-    global_ghr = ((global_ghr << 1) | (taken ? 1 : 0)) & global_ghr_mask;
+static void tournament_stats(const void* state, PredictorStats* stats) {
+    const TournamentPredictor* predictor = (const TournamentPredictor*)state;
+    stats->storage_bits = btb_storage_bits(&predictor->btb, predictor->local_bhr_bits)
+        + predictor->global_ghr_bits + 2 * (uint64_t)predictor->shared_counters.size
+        + 2 * (uint64_t)predictor->chooser.size;
+    stats->memory_bytes = btb_memory_bytes(&predictor->btb) + counter_table_bytes(&predictor->shared_counters)
+        + counter_table_bytes(&predictor->chooser);
+    stats->events = predictor->events;
 }
 
-static uint64_t parse_address(const char* line) {
-    uint64_t address;
-    sscanf(line, "Info 'riscvOVPsim/cpu', 0x%lx", &address);
-    return address;
+static void tournament_destroy(void* state) {
+    TournamentPredictor* predictor = (TournamentPredictor*)state;
+    btb_free(&predictor->btb);
+    counter_table_free(&predictor->shared_counters);
+    counter_table_free(&predictor->chooser);
+    ghr_free(&predictor->global_ghr);
+    alias_tracker_free(&predictor->aliasing);
+    free(predictor);
 }
 
-static bool determine_taken(uint64_t branch_address, uint64_t next_address) {
-    // If the next address is the branch address + 4, branch is not taken
-    return !(next_address == branch_address + 4);
+static int tournament_save(const void* state, FILE* file) {
+    const TournamentPredictor* predictor = (const TournamentPredictor*)state;
+    return btb_save(&predictor->btb, file)
+        || ghr_save(&predictor->global_ghr, file)
+        || counter_table_save(&predictor->shared_counters, file)
+        || counter_table_save(&predictor->chooser, file)
+        || folded_history_save(&predictor->chooser_history, file);
 }
 
-int Tournament(const char* inputFile) {
-  
-    int local_bhr_bits = 3;
-    int global_ghr_bits = 6;
-    int instruction_length = 64;
-    int btb_entries = 2048;
-    int chooser_size = 1024;
+static int tournament_load(void* state, FILE* file) {
+    TournamentPredictor* predictor = (TournamentPredictor*)state;
+    return btb_load(&predictor->btb, file)
+        || ghr_load(&predictor->global_ghr, file)
+        || counter_table_load(&predictor->shared_counters, file)
+        || counter_table_load(&predictor->chooser, file)
+        || folded_history_load(&predictor->chooser_history, file);
+}
 
-    int index_bits = (int)(log2(btb_entries / 2));
-    int tag_bits = instruction_length - index_bits;
-    int btb_sets = btb_entries / 2;
-    int local_bhr_mask = (1 << local_bhr_bits) - 1;
-    int local_bhr_size = (1 << local_bhr_bits); // 2^3 = 8 possible histories
-    int global_counter_size = (1 << global_ghr_bits); // 2^6 = 64 possible histories
-    int global_ghr_mask = (1 << global_ghr_bits) - 1;
+static int tournament_init(void** predictor_state, const PredictorConfig* config) {
+    int local_bhr_bits = config->bhr_bits;
+    int global_ghr_bits = config->ghr_bits;
+    int btb_entries = config->btb_entries;
 
-    BTBSet* btb = (BTBSet*)malloc(btb_sets * sizeof(BTBSet));
-    if (!btb) {
-        perror("Failed to allocate memory for BTB sets");
+    if (btb_check_bhr_bits(local_bhr_bits)) {
         return 1;
     }
-    initialize_predictors(btb, btb_sets, global_counter_size, chooser_size, local_bhr_size);
 
-    FILE* file = fopen(inputFile, "r");
-    if (!file) {
-        perror("Failed to open file");
+    TournamentPredictor* state = (TournamentPredictor*)calloc(1, sizeof(TournamentPredictor));
+    if (!state) {
+        perror("Failed to allocate memory for tournament predictor");
         return 1;
     }
 
-    
-    int total_branches = 0;
-    int mispredictions = 0;
+    state->local_bhr_bits = local_bhr_bits;
+    state->global_ghr_bits = global_ghr_bits;
+    state->local_bhr_mask = (1 << local_bhr_bits) - 1;
+    int local_bhr_size = (1 << local_bhr_bits); // 2^bhr_bits possible histories per entry
+    int global_index_bits = pht_index_bits(config, global_ghr_bits);
+    if (global_index_bits > global_ghr_bits) global_index_bits = global_ghr_bits;
 
-    char line[256];
-    uint64_t branch_address, next_address;
-    bool is_branch = true;
-
-    while (fgets(line, sizeof(line), file)) {
-        if (is_branch) {
-            // This line is the branch instruction
-            branch_address = parse_address(line);
-        }
-        else {
-            // This line is the instruction right after the branch
-            next_address = parse_address(line);
-
-            bool taken = determine_taken(branch_address, next_address);
-            uint16_t chooser_index = get_index(branch_address, index_bits) % chooser_size; // Map branch to chooser index
-
-            bool local_prediction = predict_local(btb, branch_address, index_bits, btb_sets);
-            bool global_prediction = predict_global();
-
-            // Determine which predictor to use based on the chooser's MSB
-            bool use_local = (chooser[chooser_index] >> 1) & 0x1; // MSB of chooser counter
-
-            bool prediction = use_local ? local_prediction : global_prediction;
-
-            // Update misprediction count
-            if (prediction != taken) {
-                mispredictions++;
-            }
+    if (btb_init(&state->btb, btb_entries, config->btb_ways, config->btb_replacement, local_bhr_size, config->targets)) {
+        free(state);
+        return 1;
+    }
+    state->chooser_indexing = config->chooser_index;
+    if (initialize_predictors(state, global_ghr_bits, global_index_bits, config->chooser_bits)) {
+        btb_free(&state->btb);
+        free(state);
+        return 1;
+    }
+    if (alias_tracker_init(&state->aliasing, (size_t)1 << global_index_bits)) {
+        tournament_destroy(state);
+        return 1;
+    }
 
-            update_local(btb, branch_address, taken, index_bits, btb_sets, local_bhr_mask);
-            update_global(taken, global_ghr_mask);
+    *predictor_state = state;
+    return 0;
+}
 
-            // Update chooser based on which predictor was correct
-            if (local_prediction == taken && global_prediction != taken) {
-                if (chooser[chooser_index] < 3) chooser[chooser_index]++;  // Move towards favoring local
-            }
-            else if (local_prediction != taken && global_prediction == taken) {
-                if (chooser[chooser_index] > 0) chooser[chooser_index]--;  // Move towards favoring global
-            }
+static bool tournament_btb_missed(const void* state) {
+    return ((const TournamentPredictor*)state)->way < 0;
+}
 
-            total_branches++;
-        }
+static BTB* tournament_target_btb(void* state) {
+    return &((TournamentPredictor*)state)->btb;
+}
 
-        // Toggle between branch and the instruction after
-        is_branch = !is_branch;
+// The global counters and history-indexed choosers depend on the GHR at the time of the branch
+static void tournament_prefetch(const void* state, uint64_t branch_address) {
+    const TournamentPredictor* predictor = (const TournamentPredictor*)state;
+    btb_prefetch(&predictor->btb, branch_address);
+    if (predictor->chooser_indexing == CHOOSER_INDEX_PC) {
+        PREFETCH(predictor->chooser.counters + ((branch_address & predictor->chooser_mask) >> 2));
     }
-
-    double misprediction_rate = (double)mispredictions / total_branches;
-
-    printf("\n%s for %s:\n", __func__, inputFile);
-    printf("Total Branches: %d\n", total_branches);
-    printf("Mispredictions: %d\n", mispredictions);
-    printf("Misprediction Rate: %.4f\n", misprediction_rate*100);
-
-    fclose(file);
-    free(btb);
-    free(shared_counters);
-    return 0;
 }
+
+const PredictorType tournament_predictor = {
+    "Tournament",
+    tournament_init,
+    tournament_predict,
+    tournament_update,
+    tournament_stats,
+    tournament_destroy,
+    tournament_save,
+    tournament_load,
+    NULL,
+    tournament_btb_missed,
+    tournament_target_btb,
+    tournament_prefetch,
+};
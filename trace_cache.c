@@ -0,0 +1,111 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "branch_trace.h"
+#include "filter_file.h"
+#include "mapped_file.h"
+#include "trace_cache.h"
+
+#ifdef _WIN32
+#include <process.h>
+#define process_id() _getpid()
+#else
+#include <unistd.h>
+#define process_id() getpid()
+#endif
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define HASH_LANES 4
+
+static uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t mix_word(uint64_t lane, uint64_t word) {
+    return rotate_left(lane ^ (word * HASH_MULTIPLIER), 31) * 0xC2B2AE3D27D4EB4FULL;
+}
+
+// Four independent lanes keep several multiplies in flight, so hashing runs far faster than the
+// text parsing it saves; the tail bytes and the size are folded in at the end
+static uint64_t hash_bytes(const unsigned char* data, size_t size) {
+    uint64_t lanes[HASH_LANES] = { 1, 2, 3, 4 };
+    size_t offset = 0;
+    for (; offset + HASH_LANES * 8 <= size; offset += HASH_LANES * 8) {
+        for (int i = 0; i < HASH_LANES; i++) {
+            uint64_t word;
+            memcpy(&word, data + offset + 8 * i, 8);
+            lanes[i] = mix_word(lanes[i], word);
+        }
+    }
+
+    uint64_t hash = (uint64_t)size * HASH_MULTIPLIER;
+    for (int i = 0; i < HASH_LANES; i++) {
+        hash = mix_word(hash, lanes[i]);
+    }
+    for (; offset < size; offset++) {
+        hash = mix_word(hash, data[offset]);
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    return hash ^ (hash >> 33);
+}
+
+int trace_content_hash(const char* path, uint64_t* hash) {
+    MappedFile mapped;
+    if (map_file(&mapped, path)) {
+        return 1;
+    }
+    *hash = hash_bytes((const unsigned char*)mapped.data, mapped.size);
+    unmap_file(&mapped);
+    return 0;
+}
+
+static bool cached_trace_valid(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    fclose(file);
+
+    BranchTraceReader* reader = (BranchTraceReader*)malloc(sizeof(BranchTraceReader));
+    if (!reader || branch_trace_open_reader(reader, path)) {
+        free(reader);
+        return false;
+    }
+    branch_trace_close_reader(reader);
+    free(reader);
+    return true;
+}
+
+int filter_cached(const char* trace, const char* cache, int job, char* path, size_t size, bool* reused) {
+    uint64_t hash;
+    if (trace_content_hash(trace, &hash)) {
+        return 1;
+    }
+    hash = rotate_left(hash, 7) ^ BRANCH_TRACE_VERSION; // A format change invalidates every entry
+    snprintf(path, size, "%s/%016llx.bin", cache, (unsigned long long)hash);
+
+    *reused = cached_trace_valid(path);
+    if (*reused) {
+        return 0;
+    }
+
+    // Two jobs, of this run or of another one sharing the cache, may be filtering the same entry;
+    // the process id and job index give each its own temporary file
+    char temporary[1024];
+    snprintf(temporary, sizeof(temporary), "%s.%d.%d.tmp", path, (int)process_id(), job);
+    if (filterBranchCommands(trace, temporary)) {
+        remove(temporary);
+        return 1;
+    }
+#ifdef _WIN32
+    remove(path); // rename does not replace an existing file on Windows
+#endif
+    if (rename(temporary, path) != 0) {
+        perror("Failed to move the filtered trace into the cache");
+        remove(temporary);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+#ifndef TRACE_CACHE_H
+#define TRACE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Filtered traces cached by the content of the trace they came from, so unchanged traces are not
+// filtered again. A cached file is <cache>/<16 hex digits>.bin, named by a 64-bit hash of the
+// trace contents, its size and the branch trace format version. Entries are written to a
+// temporary file and renamed into place, so an interrupted run never leaves a partial entry.
+
+// Hashes the contents of a file; returns non-zero when it cannot be read
+int trace_content_hash(const char* path, uint64_t* hash);
+
+// Stores the cached filtered path of trace in path, filtering the trace first unless the cache
+// already holds it; *reused tells which. job tells apart the jobs of a run that may filter the
+// same entry at once. Returns non-zero on failure.
+int filter_cached(const char* trace, const char* cache, int job, char* path, size_t size, bool* reused);
+
+#endif
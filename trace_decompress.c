@@ -0,0 +1,336 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "threads.h"
+#include "trace_decompress.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#define GZIP_CHUNK (1u << 30)   // zlib counts its input in 32-bit uInts
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+struct TraceDecompressor {
+    Mutex mutex;
+    CondVar not_full;
+    CondVar not_empty;
+
+    char* blocks;                   // TRACE_BLOCKS blocks of TRACE_BLOCK_SIZE bytes
+    size_t sizes[TRACE_BLOCKS];     // Bytes in each published block
+    size_t head;                    // Oldest published block
+    size_t tail;                    // Next block to publish
+    size_t filled;                  // Published blocks the reader has not released
+    bool holding;                   // The reader is still reading the head block
+    bool done;
+    bool failed;
+    bool cancelled;
+    Thread thread;
+
+    // Helper-thread private
+    TraceCompression compression;
+    const char* path;
+    const unsigned char* input;     // Compressed bytes not yet handed to the codec
+    size_t remaining;
+    char* carry;                    // Partial last line of the previous block
+    size_t carried;
+#ifdef HAVE_ZLIB
+    z_stream gzip;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream* zstd;
+    bool zstd_pending;              // The current frame is not complete yet
+#endif
+};
+
+TraceCompression trace_compression(const char* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B) {
+        return TRACE_GZIP;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD) {
+        return TRACE_ZSTD;
+    }
+    return TRACE_PLAIN;
+}
+
+#ifdef HAVE_ZLIB
+// Concatenated gzip members, as pigz or cat a.gz b.gz produce, decompress as one stream
+static int inflate_gzip(TraceDecompressor* decompressor, char* out, size_t capacity, size_t* produced, bool* ended) {
+    z_stream* stream = &decompressor->gzip;
+    stream->next_out = (Bytef*)out;
+    stream->avail_out = (uInt)capacity;
+    while (stream->avail_out > 0) {
+        if (stream->avail_in == 0) {
+            if (decompressor->remaining == 0) {
+                fprintf(stderr, "Compressed trace %s is truncated\n", decompressor->path);
+                return 1;
+            }
+            uInt chunk = decompressor->remaining < GZIP_CHUNK ? (uInt)decompressor->remaining : GZIP_CHUNK;
+            stream->next_in = (Bytef*)decompressor->input;
+            stream->avail_in = chunk;
+            decompressor->input += chunk;
+            decompressor->remaining -= chunk;
+        }
+
+        int status = inflate(stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            // Give back what the codec did not read, then look for another member
+            decompressor->input -= stream->avail_in;
+            decompressor->remaining += stream->avail_in;
+            stream->avail_in = 0;
+            if (trace_compression((const char*)decompressor->input, decompressor->remaining) != TRACE_GZIP) {
+                *ended = true;
+                break;
+            }
+            inflateReset(stream);
+        }
+        else if (status != Z_OK) {
+            fprintf(stderr, "Corrupt gzip data in %s: %s\n", decompressor->path, stream->msg ? stream->msg : "unknown error");
+            return 1;
+        }
+    }
+    *produced = capacity - stream->avail_out;
+    return 0;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+// The zstd stream decoder moves from one frame to the next by itself
+static int inflate_zstd(TraceDecompressor* decompressor, char* out, size_t capacity, size_t* produced, bool* ended) {
+    ZSTD_outBuffer output = { out, capacity, 0 };
+    while (output.pos < output.size) {
+        if (decompressor->remaining == 0 && !decompressor->zstd_pending) {
+            *ended = true;
+            break;
+        }
+
+        size_t before = output.pos;
+        ZSTD_inBuffer input = { decompressor->input, decompressor->remaining, 0 };
+        size_t hint = ZSTD_decompressStream(decompressor->zstd, &output, &input);
+        if (ZSTD_isError(hint)) {
+            fprintf(stderr, "Corrupt zstd data in %s: %s\n", decompressor->path, ZSTD_getErrorName(hint));
+            return 1;
+        }
+        decompressor->input += input.pos;
+        decompressor->remaining -= input.pos;
+        decompressor->zstd_pending = hint != 0;
+        if (input.pos == 0 && output.pos == before) {
+            fprintf(stderr, "Compressed trace %s is truncated\n", decompressor->path);
+            return 1;
+        }
+    }
+    *produced = output.pos;
+    return 0;
+}
+#endif
+
+static int decompress_into(TraceDecompressor* decompressor, char* out, size_t capacity, size_t* produced, bool* ended) {
+    switch (decompressor->compression) {
+#ifdef HAVE_ZLIB
+        case TRACE_GZIP:
+            return inflate_gzip(decompressor, out, capacity, produced, ended);
+#endif
+#ifdef HAVE_ZSTD
+        case TRACE_ZSTD:
+            return inflate_zstd(decompressor, out, capacity, produced, ended);
+#endif
+        default:
+            (void)out; (void)capacity; (void)produced; (void)ended; // Unused in a build without any codec
+            return 1;
+    }
+}
+
+// Cuts a full block after its last newline, keeping the partial line for the next block
+static size_t cut_at_line(TraceDecompressor* decompressor, char* block, size_t size) {
+    size_t end = size;
+    while (end > 0 && block[end - 1] != '\n') end--;
+    if (end == 0) {
+        return size; // A single line longer than the block is passed on in pieces
+    }
+    decompressor->carried = size - end;
+    memcpy(decompressor->carry, block + end, decompressor->carried);
+    return end;
+}
+
+static void decompress_thread(void* argument) {
+    TraceDecompressor* decompressor = (TraceDecompressor*)argument;
+    bool ended = false;
+    bool failed = false;
+
+    while (!ended && !failed) {
+        mutex_lock(&decompressor->mutex);
+        while (decompressor->filled == TRACE_BLOCKS && !decompressor->cancelled) {
+            cond_wait(&decompressor->not_full, &decompressor->mutex);
+        }
+        bool cancelled = decompressor->cancelled;
+        size_t tail = decompressor->tail;
+        mutex_unlock(&decompressor->mutex);
+        if (cancelled) {
+            break;
+        }
+
+        // The tail block is not visible to the reader until filled is bumped
+        char* block = decompressor->blocks + tail * TRACE_BLOCK_SIZE;
+        size_t size = decompressor->carried;
+        memcpy(block, decompressor->carry, size);
+        decompressor->carried = 0;
+
+        size_t produced = 0;
+        failed = decompress_into(decompressor, block + size, TRACE_BLOCK_SIZE - size, &produced, &ended) != 0;
+        size += produced;
+        if (failed || size == 0) {
+            continue;
+        }
+        if (!ended) {
+            size = cut_at_line(decompressor, block, size);
+        }
+
+        mutex_lock(&decompressor->mutex);
+        decompressor->sizes[tail] = size;
+        decompressor->tail = (tail + 1) % TRACE_BLOCKS;
+        decompressor->filled++;
+        cond_signal(&decompressor->not_empty);
+        mutex_unlock(&decompressor->mutex);
+    }
+
+    mutex_lock(&decompressor->mutex);
+    decompressor->done = true;
+    decompressor->failed = failed;
+    cond_broadcast(&decompressor->not_empty);
+    mutex_unlock(&decompressor->mutex);
+}
+
+// Sets up the codec; reports a build without it
+static int start_codec(TraceDecompressor* decompressor) {
+    switch (decompressor->compression) {
+        case TRACE_GZIP:
+#ifdef HAVE_ZLIB
+            memset(&decompressor->gzip, 0, sizeof(decompressor->gzip));
+            if (inflateInit2(&decompressor->gzip, 16 + MAX_WBITS) != Z_OK) {
+                fprintf(stderr, "Failed to start decompressing %s\n", decompressor->path);
+                return 1;
+            }
+            return 0;
+#else
+            fprintf(stderr, "%s is gzip compressed, but this build has no zlib support (-DHAVE_ZLIB, -lz)\n", decompressor->path);
+            return 1;
+#endif
+        case TRACE_ZSTD:
+#ifdef HAVE_ZSTD
+            decompressor->zstd = ZSTD_createDStream();
+            decompressor->zstd_pending = false;
+            if (!decompressor->zstd || ZSTD_isError(ZSTD_initDStream(decompressor->zstd))) {
+                fprintf(stderr, "Failed to start decompressing %s\n", decompressor->path);
+                ZSTD_freeDStream(decompressor->zstd);
+                return 1;
+            }
+            return 0;
+#else
+            fprintf(stderr, "%s is zstd compressed, but this build has no zstd support (-DHAVE_ZSTD, -lzstd)\n", decompressor->path);
+            return 1;
+#endif
+        default:
+            return 1;
+    }
+}
+
+static void end_codec(TraceDecompressor* decompressor) {
+#ifdef HAVE_ZLIB
+    if (decompressor->compression == TRACE_GZIP) {
+        inflateEnd(&decompressor->gzip);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (decompressor->compression == TRACE_ZSTD) {
+        ZSTD_freeDStream(decompressor->zstd);
+    }
+#endif
+    (void)decompressor;
+}
+
+TraceDecompressor* trace_decompressor_start(const char* data, size_t size, TraceCompression compression, const char* path) {
+    TraceDecompressor* decompressor = (TraceDecompressor*)calloc(1, sizeof(TraceDecompressor));
+    if (!decompressor) {
+        perror("Failed to allocate memory for trace decompressor");
+        return NULL;
+    }
+    decompressor->compression = compression;
+    decompressor->path = path;
+    decompressor->input = (const unsigned char*)data;
+    decompressor->remaining = size;
+    if (start_codec(decompressor)) {
+        free(decompressor);
+        return NULL;
+    }
+
+    decompressor->blocks = (char*)malloc((size_t)TRACE_BLOCKS * TRACE_BLOCK_SIZE);
+    decompressor->carry = (char*)malloc(TRACE_BLOCK_SIZE);
+    if (!decompressor->blocks || !decompressor->carry) {
+        perror("Failed to allocate memory for trace decompressor");
+        end_codec(decompressor);
+        free(decompressor->blocks);
+        free(decompressor->carry);
+        free(decompressor);
+        return NULL;
+    }
+
+    mutex_init(&decompressor->mutex);
+    cond_init(&decompressor->not_full);
+    cond_init(&decompressor->not_empty);
+    if (thread_start(&decompressor->thread, decompress_thread, decompressor)) {
+        cond_destroy(&decompressor->not_full);
+        cond_destroy(&decompressor->not_empty);
+        mutex_destroy(&decompressor->mutex);
+        end_codec(decompressor);
+        free(decompressor->blocks);
+        free(decompressor->carry);
+        free(decompressor);
+        return NULL;
+    }
+    return decompressor;
+}
+
+bool trace_decompressor_next_block(TraceDecompressor* decompressor, const char** data, size_t* size) {
+    mutex_lock(&decompressor->mutex);
+    if (decompressor->holding) {
+        decompressor->head = (decompressor->head + 1) % TRACE_BLOCKS;
+        decompressor->filled--;
+        decompressor->holding = false;
+        cond_signal(&decompressor->not_full);
+    }
+    while (decompressor->filled == 0 && !decompressor->done) {
+        cond_wait(&decompressor->not_empty, &decompressor->mutex);
+    }
+    if (decompressor->filled == 0) {
+        mutex_unlock(&decompressor->mutex);
+        return false;
+    }
+    decompressor->holding = true;
+    *data = decompressor->blocks + decompressor->head * TRACE_BLOCK_SIZE;
+    *size = decompressor->sizes[decompressor->head];
+    mutex_unlock(&decompressor->mutex);
+    return true;
+}
+
+int trace_decompressor_finish(TraceDecompressor* decompressor) {
+    mutex_lock(&decompressor->mutex);
+    decompressor->cancelled = true;
+    cond_broadcast(&decompressor->not_full);
+    mutex_unlock(&decompressor->mutex);
+    thread_join(&decompressor->thread);
+
+    int result = decompressor->failed ? 1 : 0;
+    cond_destroy(&decompressor->not_full);
+    cond_destroy(&decompressor->not_empty);
+    mutex_destroy(&decompressor->mutex);
+    end_codec(decompressor);
+    free(decompressor->blocks);
+    free(decompressor->carry);
+    free(decompressor);
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef TRACE_DECOMPRESS_H
+#define TRACE_DECOMPRESS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Streaming decompression of gzip and zstd compressed traces, recognised by their magic bytes.
+// A helper thread inflates the compressed file into a small ring of blocks while the filter reads
+// the previous ones, so a trace never has to be decompressed to disk. Each block ends on a line
+// boundary unless a single line is longer than a whole block.
+// gzip needs a build with -DHAVE_ZLIB (link -lz), zstd one with -DHAVE_ZSTD (link -lzstd).
+
+#define TRACE_BLOCK_SIZE (1 << 20)
+#define TRACE_BLOCKS 4
+
+typedef enum {
+    TRACE_PLAIN = 0,
+    TRACE_GZIP,
+    TRACE_ZSTD
+} TraceCompression;
+
+typedef struct TraceDecompressor TraceDecompressor;
+
+TraceCompression trace_compression(const char* data, size_t size);
+
+// Starts decompressing data, which must stay valid until trace_decompressor_finish.
+// path only names the trace in messages. Returns NULL on failure, or when the build lacks the codec.
+TraceDecompressor* trace_decompressor_start(const char* data, size_t size, TraceCompression compression, const char* path);
+
+// Hands out the next block, returning the previous one to the helper thread; false at the end of
+// the stream or after an error
+bool trace_decompressor_next_block(TraceDecompressor* decompressor, const char** data, size_t* size);
+
+// Stops the helper thread, even halfway through the stream, and frees the decompressor.
+// Returns 1 when the compressed data was corrupt or truncated.
+int trace_decompressor_finish(TraceDecompressor* decompressor);
+
+#endif
@@ -0,0 +1,172 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace_list.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <glob.h>
+#endif
+
+void trace_list_init(TraceList* list) {
+    list->paths = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void trace_list_free(TraceList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    trace_list_init(list);
+}
+
+int trace_list_add(TraceList* list, const char* path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? 2 * list->capacity : 16;
+        char** paths = (char**)realloc(list->paths, capacity * sizeof(char*));
+        if (!paths) {
+            perror("Failed to allocate memory for the trace list");
+            return 1;
+        }
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+
+    size_t length = strlen(path);
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        perror("Failed to allocate memory for the trace list");
+        return 1;
+    }
+    memcpy(copy, path, length + 1);
+    list->paths[list->count++] = copy;
+    return 0;
+}
+
+#ifdef _WIN32
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// FindFirstFile only wildcards the last component and returns bare names, so the directory
+// part of the pattern is put back in front of each match
+static int add_matches(TraceList* list, const char* pattern) {
+    WIN32_FIND_DATAA found;
+    HANDLE search = FindFirstFileA(pattern, &found);
+    if (search == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "No trace matches %s\n", pattern);
+        return 1;
+    }
+
+    size_t directory_length = trace_base_name(pattern) - pattern;
+    int first = list->count;
+    int result = 0;
+    do {
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        char path[MAX_PATH * 2];
+        snprintf(path, sizeof(path), "%.*s%s", (int)directory_length, pattern, found.cFileName);
+        if (trace_list_add(list, path)) {
+            result = 1;
+            break;
+        }
+    } while (FindNextFileA(search, &found));
+    FindClose(search);
+
+    qsort(list->paths + first, list->count - first, sizeof(char*), compare_paths);
+    return result;
+}
+
+#else
+
+static int add_matches(TraceList* list, const char* pattern) {
+    glob_t matches;
+    if (glob(pattern, 0, NULL, &matches) != 0) {
+        fprintf(stderr, "No trace matches %s\n", pattern);
+        globfree(&matches);
+        return 1;
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < matches.gl_pathc && result == 0; i++) {
+        result = trace_list_add(list, matches.gl_pathv[i]);
+    }
+    globfree(&matches); // glob already sorts its matches
+    return result;
+}
+
+#endif
+
+int trace_list_add_pattern(TraceList* list, const char* pattern) {
+    if (!strpbrk(pattern, "*?")) {
+        return trace_list_add(list, pattern);
+    }
+    return add_matches(list, pattern);
+}
+
+static char* trim_line(char* line) {
+    while (*line == ' ' || *line == '\t') line++;
+    char* end = line + strlen(line);
+    while (end > line && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    *end = '\0';
+    return line;
+}
+
+int trace_list_add_manifest(TraceList* list, const char* manifest) {
+    FILE* file = fopen(manifest, "r");
+    if (!file) {
+        perror("Failed to open trace manifest");
+        return 1;
+    }
+
+    char line[1024];
+    int result = 0;
+    while (result == 0 && fgets(line, sizeof(line), file)) {
+        char* path = trim_line(line);
+        if (path[0] == '\0' || path[0] == '#') {
+            continue;
+        }
+        result = trace_list_add_pattern(list, path);
+    }
+    fclose(file);
+    return result;
+}
+
+const char* trace_base_name(const char* path) {
+    const char* name = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+    return name;
+}
+
+// Length of name without its extension
+static int stem_length(const char* name, int length) {
+    int dot = length;
+    while (dot > 0 && name[dot - 1] != '.') dot--;
+    return dot > 1 ? dot - 1 : length;
+}
+
+void filtered_trace_path(char* path, size_t size, const char* trace, const char* directory) {
+    const char* name = trace_base_name(trace);
+    int length = stem_length(name, (int)strlen(name));
+    const char* extension = name + length;
+    if (strcmp(extension, ".gz") == 0 || strcmp(extension, ".zst") == 0) {
+        length = stem_length(name, length);
+    }
+
+    if (directory[0]) {
+        snprintf(path, size, "%s/%.*s_filtered.bin", directory, length, name);
+    }
+    else {
+        snprintf(path, size, "%.*s%.*s_filtered.bin", (int)(name - trace), trace, length, name);
+    }
+}
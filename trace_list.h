@@ -0,0 +1,34 @@
+#ifndef TRACE_LIST_H
+#define TRACE_LIST_H
+
+#include <stddef.h>
+
+// Growable list of trace paths gathered from the command line
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+} TraceList;
+
+void trace_list_init(TraceList* list);
+void trace_list_free(TraceList* list);
+
+// Adds a copy of path; returns non-zero when out of memory
+int trace_list_add(TraceList* list, const char* path);
+
+// Adds every file matching a pattern with * or ? wildcards, in sorted order, or the path itself
+// when it has none. Returns non-zero when nothing matches.
+int trace_list_add_pattern(TraceList* list, const char* pattern);
+
+// Adds the traces named in a manifest, one path or pattern per line; blank lines and lines
+// starting with # are skipped
+int trace_list_add_manifest(TraceList* list, const char* manifest);
+
+// File name part of a path, used to name per-trace outputs
+const char* trace_base_name(const char* path);
+
+// <directory>/<base name without its extension>_filtered.bin, or the same next to the trace
+// when directory is empty. A .gz or .zst suffix goes first, so trace.trc.gz gives trace_filtered.bin.
+void filtered_trace_path(char* path, size_t size, const char* trace, const char* directory);
+
+#endif
@@ -0,0 +1,87 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "trace_reader.h"
+
+#define TRACE_PREFIX "Info 'riscvOVPsim/cpu', 0x"
+#define TRACE_PREFIX_LENGTH (sizeof(TRACE_PREFIX) - 1)
+#define MAX_ADDRESS_DIGITS 16
+
+int trace_reader_open(TraceReader* reader, const char* path) {
+    if (map_file(&reader->file, path)) {
+        return 1;
+    }
+    reader->decompressor = NULL;
+    reader->pos = reader->file.data;
+    reader->end = reader->file.data + reader->file.size;
+
+    TraceCompression compression = trace_compression(reader->file.data, reader->file.size);
+    if (compression != TRACE_PLAIN) {
+        reader->decompressor = trace_decompressor_start(reader->file.data, reader->file.size, compression, path);
+        if (!reader->decompressor) {
+            unmap_file(&reader->file);
+            return 1;
+        }
+        reader->pos = reader->end = NULL;
+    }
+    return 0;
+}
+
+bool trace_reader_next_line(TraceReader* reader, const char** line, size_t* length) {
+    while (reader->pos == reader->end) {
+        size_t size;
+        if (!reader->decompressor || !trace_decompressor_next_block(reader->decompressor, &reader->pos, &size)) {
+            return false;
+        }
+        reader->end = reader->pos + size;
+    }
+
+    const char* start = reader->pos;
+    const char* newline = (const char*)memchr(start, '\n', reader->end - start);
+    const char* stop = newline ? newline : reader->end;
+
+    reader->pos = newline ? newline + 1 : reader->end;
+    *line = start;
+    *length = stop - start;
+    return true;
+}
+
+int trace_reader_close(TraceReader* reader) {
+    int result = reader->decompressor ? trace_decompressor_finish(reader->decompressor) : 0;
+    unmap_file(&reader->file);
+    return result;
+}
+
+static int hex_value(unsigned char c) {
+    unsigned digit = c - '0';
+    if (digit < 10) return (int)digit;
+    unsigned letter = (c | 0x20) - 'a'; // Folds 'A'-'F' onto 'a'-'f'
+    if (letter < 6) return (int)letter + 10;
+    return -1;
+}
+
+bool parse_trace_address(const char* line, size_t length, uint64_t* address) {
+    if (length <= TRACE_PREFIX_LENGTH || memcmp(line, TRACE_PREFIX, TRACE_PREFIX_LENGTH) != 0) {
+        return false;
+    }
+
+    const char* digits = line + TRACE_PREFIX_LENGTH;
+    size_t available = length - TRACE_PREFIX_LENGTH;
+    if (available > MAX_ADDRESS_DIGITS) available = MAX_ADDRESS_DIGITS;
+
+    uint64_t value = 0;
+    size_t count = 0;
+    for (; count < available; count++) {
+        int nibble = hex_value((unsigned char)digits[count]);
+        if (nibble < 0) break;
+        value = (value << 4) | (uint64_t)nibble;
+    }
+
+    if (count == 0) {
+        return false;
+    }
+    *address = value;
+    return true;
+}
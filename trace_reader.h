@@ -0,0 +1,29 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "mapped_file.h"
+#include "trace_decompress.h"
+
+// Zero-copy line reader over a memory-mapped riscvOVPsim trace, plain or gzip/zstd compressed.
+// Lines point straight into the mapping, or into the current decompressed block, and are NOT
+// NUL-terminated. A line stays valid until the next call.
+typedef struct {
+    MappedFile file;
+    TraceDecompressor* decompressor;    // NULL for a plain trace
+    const char* pos;
+    const char* end;
+} TraceReader;
+
+int trace_reader_open(TraceReader* reader, const char* path);
+bool trace_reader_next_line(TraceReader* reader, const char** line, size_t* length);
+
+// Returns 1 when a compressed trace turned out corrupt or truncated
+int trace_reader_close(TraceReader* reader);
+
+// Parses the instruction address of an "Info 'riscvOVPsim/cpu', 0x..." line
+bool parse_trace_address(const char* line, size_t length, uint64_t* address);
+
+#endif
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads.h"
+#include "worker_pool.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+typedef struct {
+    JobFunction job;
+    void* context;
+    int job_count;
+    int next_job;
+    Mutex mutex;
+} JobQueue;
+
+int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+static void worker(void* argument) {
+    JobQueue* queue = (JobQueue*)argument;
+
+    for (;;) {
+        mutex_lock(&queue->mutex);
+        int index = queue->next_job++;
+        mutex_unlock(&queue->mutex);
+
+        if (index >= queue->job_count) {
+            return;
+        }
+        queue->job(queue->context, index);
+    }
+}
+
+void run_jobs(JobFunction job, void* context, int job_count, int thread_count) {
+    if (thread_count <= 0) thread_count = cpu_count();
+    if (thread_count > job_count) thread_count = job_count;
+
+    JobQueue queue;
+    queue.job = job;
+    queue.context = context;
+    queue.job_count = job_count;
+    queue.next_job = 0;
+    mutex_init(&queue.mutex);
+
+    // The calling thread is one of the workers
+    Thread* threads = NULL;
+    int started = 0;
+    if (thread_count > 1) {
+        threads = (Thread*)malloc((thread_count - 1) * sizeof(Thread));
+        if (!threads) {
+            perror("Failed to allocate memory for worker threads");
+        }
+        for (int i = 0; threads && i < thread_count - 1; i++) {
+            if (thread_start(&threads[i], worker, &queue)) break;
+            started++;
+        }
+    }
+
+    worker(&queue);
+
+    for (int i = 0; i < started; i++) {
+        thread_join(&threads[i]);
+    }
+    free(threads);
+    mutex_destroy(&queue.mutex);
+}
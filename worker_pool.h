@@ -0,0 +1,13 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+typedef void (*JobFunction)(void* context, int index);
+
+// Runs job(context, index) for every index in [0, job_count) on up to thread_count threads
+// (0 = one per CPU) and returns once all of them have finished. Jobs are handed out in
+// index order, but may complete in any order.
+void run_jobs(JobFunction job, void* context, int job_count, int thread_count);
+
+int cpu_count(void);
+
+#endif